@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+
+#include <juce_core/juce_core.h>
+
+template <typename Func>
+static double timeSeconds(Func&& func)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto start = Clock::now();
+    func();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int runBitModulationCheck();
+int runDelayGrowthCheck();
+int runTanhCheck();
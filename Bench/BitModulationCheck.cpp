@@ -0,0 +1,96 @@
+#include <chrono>
+
+#include "BitModulation.h"
+#include "BenchUtils.h"
+
+using namespace juce;
+
+namespace
+{
+    // Random operands whose exponents are less than 64 apart: beyond that the shift in and_/or_/xor_ is undefined,
+    // so the reference has no meaningful result to compare against.
+    void fillOperands(Random& random, float* a, float* b, int numValues, float minExponent, float maxExponent)
+    {
+        auto randomValue = [&]
+        {
+            const auto exponent = minExponent + (maxExponent - minExponent) * random.nextFloat();
+            return std::exp2(exponent) * (random.nextBool() ? 1.0f : -1.0f);
+        };
+
+        for (size_t i = 0; i < (size_t) numValues; ++i)
+        {
+            a[i] = randomValue();
+            b[i] = randomValue();
+
+            // the interesting corners: zeros, equal magnitudes and equal exponents
+            switch (i % 16)
+            {
+                case 1: a[i] = random.nextBool() ? 0.0f : -0.0f; break;
+                case 2: b[i] = random.nextBool() ? 0.0f : -0.0f; break;
+                case 3: b[i] = random.nextBool() ? a[i] : -a[i]; break;
+                case 4: b[i] = a[i] * 1.5f; break;
+                default: break;
+            }
+        }
+    }
+}
+
+int runBitModulationCheck()
+{
+    constexpr int numValues = 1 << 20;
+
+    const BitModulation::Operation operations[] { BitModulation::Operation::XOR, BitModulation::Operation::AND, BitModulation::Operation::OR };
+    const char* names[] { "NONE", "XOR", "AND", "OR" };
+
+    std::vector<float> a(numValues), b(numValues), reference(numValues), result(numValues);
+    Random random(0xb17);
+
+    int numFailures = 0;
+
+    for (auto operation : operations)
+    {
+        const auto referenceFunc = BitModulation::getOpFunc(operation);
+        int numMismatches = 0;
+
+        // audio range, then values small enough for the results to be denormal
+        for (auto range : { std::make_pair(-60.0f, 3.0f), std::make_pair(-125.0f, -70.0f) })
+        {
+            fillOperands(random, a.data(), b.data(), numValues, range.first, range.second);
+
+            const auto referenceTime = timeSeconds([&]
+            {
+                for (size_t i = 0; i < (size_t) numValues; ++i)
+                    reference[i] = referenceFunc(a[i], b[i]);
+            });
+
+            const auto integerTime = timeSeconds([&]
+            {
+                BitModulation::processBlock(operation, a.data(), b.data(), result.data(), numValues);
+            });
+
+            for (size_t i = 0; i < (size_t) numValues; ++i)
+            {
+                // compared with ==, a zero may legitimately come out with the other sign
+                if (reference[i] != result[i])
+                {
+                    if (numMismatches++ < 5)
+                        std::cerr << names[operation] << " mismatch: a=" << a[i] << " b=" << b[i]
+                                  << " reference=" << reference[i] << " integer=" << result[i] << std::endl;
+                }
+            }
+
+            std::cerr << names[operation] << " [2^" << range.first << ", 2^" << range.second << "]: "
+                      << referenceTime * 1.0e9 / numValues << " ns/op reference, "
+                      << integerTime * 1.0e9 / numValues << " ns/op integer" << std::endl;
+        }
+
+        if (numMismatches > 0)
+        {
+            std::cerr << names[operation] << ": " << numMismatches << " mismatches" << std::endl;
+            ++numFailures;
+        }
+    }
+
+    std::cerr << (numFailures == 0 ? "BitModulation check passed" : "BitModulation check FAILED") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
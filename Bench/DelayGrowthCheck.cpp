@@ -0,0 +1,131 @@
+#include <chrono>
+
+#include "DelayProcessor.h"
+#include "BenchUtils.h"
+
+using namespace juce;
+
+namespace
+{
+    constexpr double SAMPLE_RATE = 48000.0;
+    constexpr int BLOCK_SIZE = 256;
+
+    // longer than the chunks the lines' history is copied in
+    constexpr int LARGE_BLOCK_SIZE = 32768;
+    constexpr float MAX_DELAY_TIME = 10.0f;
+
+    // the echo peak can move by the filters' group delay, no further
+    constexpr int MAX_ECHO_ERROR_SMPLS = 4;
+
+    // a clean echo: no feedback, modulation, noise or effects
+    void setParameters(DelayProcessor& processor, float time_ms)
+    {
+        processor.setDelayParameters(time_ms, 0.0f, DelayProcessor::ToneType::DIGITAL, 1.0f, 0.0f,
+                                     FastMathLFO::LFOWave::TRI, -100.0f, DelayProcessor::NoiseType::WHITE);
+
+        processor.setEffectsParameters(DelayProcessor::EffectsRouting::OUT, false, MIN_BITCRUSHER_Q, MAX_DECIMATOR_RATIO, 0.0f,
+                                       MAX_FILTER_CUTOFF_FREQ, MIN_FILTER_Q, DelayProcessor::FilterPosition::PRE_BITMOD,
+                                       MIN_GAIN_DB, BitModulation::Operation::NONE, DelayProcessor::BitModOperands::POST_FX_POST_FX,
+                                       MIN_FILTER_CUTOFF_FREQ, MIN_FILTER_Q, DelayProcessor::FilterPosition::PRE_BITMOD);
+    }
+
+    // Steps the time past what the lines were prepared for and sends an impulse with the last sample of the first
+    // block, so that the grown lines only have it if they got the history. The first second is processed in real
+    // time, the lines then grow in the background, before the echo is looked for.
+    int runGrowth(CircularBuffer::Storage storage, const char* name, bool realtime, int blockSize)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        ScopedNoDenormals noDenormals;
+
+        DelayProcessor processor;
+        processor.setDelayStorage(storage);
+        processor.setMaxDelayTime(MAX_DELAY_TIME);
+        processor.prepareToPlay(SAMPLE_RATE, blockSize);
+        processor.setNonRealtime(! realtime);
+        setParameters(processor, 350.0f);
+
+        AudioBuffer<float> block(NUM_CHANNELS, blockSize);
+        const auto blockDuration_ms = (int) (1000.0 * blockSize / SAMPLE_RATE);
+        const auto impulse = blockSize - 1;
+
+        int numFailures = 0;
+
+        for (auto time_ms : { 2500.0f, 5000.0f, 9500.0f })
+        {
+            const auto memoryBefore = processor.getMemorySize();
+            setParameters(processor, time_ms);
+
+            const auto expected = roundToInt(time_ms * 0.001 * SAMPLE_RATE);
+            const auto numBlocks = (impulse + expected + (int) SAMPLE_RATE) / blockSize;
+
+            double worst_ns = 0.0;
+            int64 echoPosition = -1;
+            float echoPeak = 0.0f;
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                block.clear();
+
+                if (i == 0)
+                    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+                        block.setSample(channel, impulse, 1.0f);
+
+                const auto start = Clock::now();
+                processor.processBlock(block);
+                const auto end = Clock::now();
+
+                worst_ns = jmax(worst_ns, (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+                if (realtime && i * blockSize < (int) SAMPLE_RATE)
+                    Thread::sleep(blockDuration_ms);
+
+                // the loudest sample past the dry signal
+                for (int n = 0; n < blockSize; ++n)
+                {
+                    const auto position = (int64) i * blockSize + n - impulse;
+                    const auto y = std::abs(block.getSample(0, n));
+
+                    if (position > expected / 2 && y > echoPeak)
+                    {
+                        echoPeak = y;
+                        echoPosition = position;
+                    }
+                }
+            }
+
+            const auto memoryGrowth = (int64) processor.getMemorySize() - (int64) memoryBefore;
+            const auto error = echoPosition - expected;
+
+            std::cerr << name << (realtime ? " realtime " : " offline ") << blockSize << " " << time_ms << " ms: echo at "
+                      << echoPosition << " (" << expected << " expected), worst block " << worst_ns * 1.0e-3
+                      << " us, memory " << (memoryGrowth >= 0 ? "+" : "") << memoryGrowth << " bytes" << std::endl;
+
+            if (std::abs(error) > MAX_ECHO_ERROR_SMPLS || echoPeak < 0.5f)
+            {
+                std::cerr << name << " " << time_ms << " ms: echo " << echoPeak << " at " << echoPosition << ", off by "
+                          << error << " samples" << std::endl;
+                ++numFailures;
+            }
+        }
+
+        processor.releaseResources(false);
+        return numFailures;
+    }
+}
+
+int runDelayGrowthCheck()
+{
+    int numFailures = 0;
+
+    for (auto realtime : { true, false })
+    {
+        numFailures += runGrowth(CircularBuffer::FLOAT, "FLOAT", realtime, BLOCK_SIZE);
+        numFailures += runGrowth(CircularBuffer::BFLOAT16, "BFLOAT16", realtime, BLOCK_SIZE);
+    }
+
+    numFailures += runGrowth(CircularBuffer::FLOAT, "FLOAT", true, LARGE_BLOCK_SIZE);
+
+    std::cerr << (numFailures == 0 ? "delay growth check passed" : "delay growth check FAILED") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
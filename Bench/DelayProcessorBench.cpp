@@ -0,0 +1,327 @@
+#include <chrono>
+
+#include "DelayProcessor.h"
+#include "BenchUtils.h"
+
+using namespace juce;
+
+namespace
+{
+    struct Scenario
+    {
+        String name;
+        DelayProcessor::ToneType toneType = DelayProcessor::ToneType::DIGITAL;
+        DelayProcessor::EffectsRouting effectsRouting = DelayProcessor::EffectsRouting::OUT;
+        BitModulation::Operation bmOperation = BitModulation::Operation::NONE;
+        bool modSmoothing = false;
+    };
+
+    struct Result
+    {
+        double nsPerSample = 0.0;
+        double realTimeFactor = 0.0;
+        double worstBlock_us = 0.0;
+        double meanBlock_us = 0.0;
+        size_t memoryBytes = 0;
+        bool memoryLocked = false;
+    };
+
+    constexpr int BLOCK_SIZES[] { 16, 32, 64, 128, 512 };
+    constexpr double SAMPLE_RATES[] { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+    Array<Scenario> buildScenarios()
+    {
+        Array<Scenario> scenarios;
+
+        const StringArray toneNames { "DIGITAL", "TAPE" };
+        const StringArray routingNames { "IN", "OUT" };
+        const StringArray bmNames { "NONE", "XOR", "AND", "OR" };
+
+        for (int tone = 0; tone < toneNames.size(); ++tone)
+            for (int routing = 0; routing < routingNames.size(); ++routing)
+                for (int op = 0; op < bmNames.size(); ++op)
+                    for (int smoothing = 0; smoothing < 2; ++smoothing)
+                    {
+                        Scenario s;
+                        s.toneType = static_cast<DelayProcessor::ToneType>(tone);
+                        s.effectsRouting = static_cast<DelayProcessor::EffectsRouting>(routing);
+                        s.bmOperation = static_cast<BitModulation::Operation>(op);
+                        s.modSmoothing = smoothing == 1;
+                        s.name = toneNames[tone] + "/" + routingNames[routing] + "/" + bmNames[op]
+                               + (s.modSmoothing ? "/smoothing" : "/static");
+                        scenarios.add(s);
+                    }
+
+        return scenarios;
+    }
+
+    // alternate moves the mod rate, the stereo phase and both filter cutoffs, so the smoothing scenarios keep them ramping
+    void setParameters(DelayProcessor& processor, const Scenario& scenario, bool alternate)
+    {
+        processor.setDelayParameters(350.0f, 60.0f, scenario.toneType, alternate ? 5.0f : 0.5f, 30.0f,
+                                     FastMathLFO::LFOWave::TRI, -50.0f, DelayProcessor::NoiseType::WHITE);
+        processor.setModStereoPhase(alternate ? 90.0f : 45.0f);
+
+        processor.setEffectsParameters(scenario.effectsRouting, false, 0.01f, 0.5f, 0.1f,
+                                       alternate ? 2000.0f : 4000.0f, 1.5f, DelayProcessor::FilterPosition::PRE_BITMOD,
+                                       -12.0f, scenario.bmOperation, DelayProcessor::BitModOperands::POST_FX_POST_FX,
+                                       alternate ? 240.0f : 120.0f, 0.707f, DelayProcessor::FilterPosition::PRE_BITMOD);
+    }
+
+    // a few detuned partials plus some noise, so the bit ops and filters see a realistic signal
+    void fillSyntheticInput(AudioBuffer<float>& input, double sampleRate)
+    {
+        Random random(0x5eed);
+
+        for (int channel = 0; channel < input.getNumChannels(); ++channel)
+        {
+            auto* data = input.getWritePointer(channel);
+            const auto detune = 1.0 + 0.003 * channel;
+
+            for (int i = 0; i < input.getNumSamples(); ++i)
+            {
+                const auto t = i / sampleRate;
+                auto x = 0.25 * std::sin(MathConstants<double>::twoPi * 110.0 * detune * t)
+                       + 0.15 * std::sin(MathConstants<double>::twoPi * 440.0 * detune * t)
+                       + 0.05 * (2.0 * random.nextDouble() - 1.0);
+
+                // gate it, so the delay tail is heard alone half of the time
+                if (std::fmod(t, 1.0) > 0.5)
+                    x *= 0.0;
+
+                data[i] = (float) x;
+            }
+        }
+    }
+
+    Result runScenario(const Scenario& scenario, double sampleRate, int blockSize, double seconds,
+                       FastTanh::Approximation softClipperApproximation, CircularBuffer::Interpolation delayInterpolation,
+                       CircularBuffer::Storage delayStorage, bool lockMemory)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        // same as the plugin's processBlock, filter tails would otherwise run into denormals
+        ScopedNoDenormals noDenormals;
+
+        DelayProcessor processor;
+        processor.setSoftClipperApproximation(softClipperApproximation);
+        processor.setDelayInterpolation(delayInterpolation);
+        processor.setDelayStorage(delayStorage);
+        processor.setLockMemory(lockMemory);
+        processor.prepareToPlay(sampleRate, blockSize);
+        setParameters(processor, scenario, false);
+
+        const int numBlocks = jmax(1, (int) (seconds * sampleRate) / blockSize);
+        const int numWarmupBlocks = jmax(1, (int) (0.25 * sampleRate) / blockSize);
+
+        AudioBuffer<float> input(NUM_CHANNELS, (int) sampleRate);
+        fillSyntheticInput(input, sampleRate);
+
+        AudioBuffer<float> block(NUM_CHANNELS, blockSize);
+        int inputPosition = 0;
+
+        auto nextInputBlock = [&]
+        {
+            if (inputPosition + blockSize > input.getNumSamples())
+                inputPosition = 0;
+
+            for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+                block.copyFrom(channel, 0, input, channel, inputPosition, blockSize);
+
+            inputPosition += blockSize;
+        };
+
+        for (int i = 0; i < numWarmupBlocks; ++i)
+        {
+            nextInputBlock();
+            processor.processBlock(block);
+        }
+
+        double total_ns = 0.0;
+        double worst_ns = 0.0;
+
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            nextInputBlock();
+
+            // keep the smoothers ramping for the whole run
+            if (scenario.modSmoothing)
+                setParameters(processor, scenario, (i & 1) == 1);
+
+            const auto start = Clock::now();
+            processor.processBlock(block);
+            const auto end = Clock::now();
+
+            const auto elapsed_ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            total_ns += elapsed_ns;
+            worst_ns = jmax(worst_ns, elapsed_ns);
+        }
+
+        const auto numSamples = (double) numBlocks * blockSize;
+
+        Result result;
+        result.nsPerSample = total_ns / numSamples;
+        result.realTimeFactor = (total_ns * 1.0e-9) / (numSamples / sampleRate);
+        result.worstBlock_us = worst_ns * 1.0e-3;
+        result.meanBlock_us = total_ns * 1.0e-3 / numBlocks;
+        result.memoryBytes = processor.getMemorySize();
+        result.memoryLocked = processor.isMemoryLocked();
+        return result;
+    }
+
+    template <typename Type, size_t N>
+    Array<Type> parseList(const ArgumentList& args, StringRef option, const Type (&defaults)[N])
+    {
+        Array<Type> values;
+
+        if (args.containsOption(option))
+        {
+            for (auto& token : StringArray::fromTokens(args.getValueForOption(option), ",", ""))
+                values.add(static_cast<Type>(token.getDoubleValue()));
+        }
+        else
+        {
+            for (auto value : defaults)
+                values.add(value);
+        }
+
+        return values;
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: StrangeReturns_Bench [options]" << std::endl
+                  << "  --seconds=<s>         audio seconds processed per run (default 1)" << std::endl
+                  << "  --blocks=<a,b,...>    block sizes (default 16,32,64,128,512)" << std::endl
+                  << "  --rates=<a,b,...>     sample rates (default 44100 to 192000)" << std::endl
+                  << "  --filter=<substring>  only run scenarios whose name contains this" << std::endl
+                  << "  --tanh=<name>         TAPE soft clipper: EXACT, PADE (default), POLYNOMIAL or TABLE" << std::endl
+                  << "  --interpolation=<name> delay line reads: LINEAR, CUBIC (default) or SINC" << std::endl
+                  << "  --storage=<name>      delay line history: FLOAT (default) or BFLOAT16" << std::endl
+                  << "  --lock-memory         lock the processor's memory into RAM" << std::endl
+                  << "  --output=<file>       write the JSON report to a file instead of stdout" << std::endl
+                  << "  --check-bitmod        compare the integer BitModulation kernels against fp_xor/fp_and/fp_or" << std::endl
+                  << "  --check-growth        grow the delay lines past 2 s and check where the echo lands" << std::endl
+                  << "  --check-tanh          measure the error and speed of the FastTanh approximations" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption("--check-bitmod"))
+        return runBitModulationCheck();
+
+    if (args.containsOption("--check-growth"))
+        return runDelayGrowthCheck();
+
+    if (args.containsOption("--check-tanh"))
+        return runTanhCheck();
+
+    const auto seconds = args.containsOption("--seconds") ? args.getValueForOption("--seconds").getDoubleValue() : 1.0;
+    const auto blockSizes = parseList(args, "--blocks", BLOCK_SIZES);
+    const auto sampleRates = parseList(args, "--rates", SAMPLE_RATES);
+    const auto filter = args.getValueForOption("--filter");
+
+    const StringArray tanhNames { "EXACT", "PADE", "POLYNOMIAL", "TABLE" };
+    const auto tanhName = args.containsOption("--tanh") ? args.getValueForOption("--tanh").toUpperCase() : String("PADE");
+
+    if (! tanhNames.contains(tanhName))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto softClipperApproximation = static_cast<FastTanh::Approximation>(tanhNames.indexOf(tanhName));
+
+    const StringArray interpolationNames { "LINEAR", "CUBIC", "SINC" };
+    const auto interpolationName = args.containsOption("--interpolation") ? args.getValueForOption("--interpolation").toUpperCase()
+                                                                          : String("CUBIC");
+
+    if (! interpolationNames.contains(interpolationName))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto delayInterpolation = static_cast<CircularBuffer::Interpolation>(interpolationNames.indexOf(interpolationName));
+
+    const StringArray storageNames { "FLOAT", "BFLOAT16" };
+    const auto storageName = args.containsOption("--storage") ? args.getValueForOption("--storage").toUpperCase() : String("FLOAT");
+
+    if (! storageNames.contains(storageName))
+    {
+        printUsage();
+        return 1;
+    }
+
+    const auto delayStorage = static_cast<CircularBuffer::Storage>(storageNames.indexOf(storageName));
+    const auto lockMemory = args.containsOption("--lock-memory");
+
+    Array<var> runs;
+
+    for (auto& scenario : buildScenarios())
+    {
+        if (filter.isNotEmpty() && ! scenario.name.contains(filter))
+            continue;
+
+        for (auto sampleRate : sampleRates)
+        {
+            for (auto blockSize : blockSizes)
+            {
+                const auto result = runScenario(scenario, sampleRate, blockSize, seconds, softClipperApproximation,
+                                                delayInterpolation, delayStorage, lockMemory);
+
+                auto* run = new DynamicObject();
+                run->setProperty("scenario", scenario.name);
+                run->setProperty("sampleRate", sampleRate);
+                run->setProperty("blockSize", blockSize);
+                run->setProperty("nsPerSample", result.nsPerSample);
+                run->setProperty("realTimeFactor", result.realTimeFactor);
+                run->setProperty("meanBlock_us", result.meanBlock_us);
+                run->setProperty("worstBlock_us", result.worstBlock_us);
+                run->setProperty("memoryBytes", (int64) result.memoryBytes);
+                run->setProperty("memoryLocked", result.memoryLocked);
+                runs.add(var(run));
+
+                std::cerr << scenario.name << " @ " << sampleRate << " Hz / " << blockSize << ": "
+                          << result.nsPerSample << " ns/sample" << std::endl;
+            }
+        }
+    }
+
+    auto* report = new DynamicObject();
+    report->setProperty("plugin", "StrangeReturns");
+    report->setProperty("numChannels", NUM_CHANNELS);
+    report->setProperty("secondsPerRun", seconds);
+    report->setProperty("softClipper", tanhName);
+    report->setProperty("interpolation", interpolationName);
+    report->setProperty("storage", storageName);
+    report->setProperty("runs", runs);
+
+    const auto json = JSON::toString(var(report));
+
+    if (args.containsOption("--output"))
+    {
+        File output = File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+        if (! output.replaceWithText(json))
+        {
+            std::cerr << "Could not write " << output.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
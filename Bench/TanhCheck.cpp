@@ -0,0 +1,99 @@
+#include <vector>
+
+#include "FastTanh.h"
+#include "BenchUtils.h"
+
+using namespace juce;
+
+int runTanhCheck()
+{
+    constexpr int numValues = 1 << 20;
+
+    const FastTanh::Approximation approximations[] { FastTanh::EXACT, FastTanh::PADE, FastTanh::POLYNOMIAL, FastTanh::TABLE };
+    const char* names[] { "EXACT", "PADE", "POLYNOMIAL", "TABLE" };
+    const float maxErrors[] { 0.0f, FastTanh::PADE_MAX_ERROR, FastTanh::POLYNOMIAL_MAX_ERROR, FastTanh::TABLE_MAX_ERROR };
+
+    // a dense sweep over the interesting range, then the extremes
+    std::vector<float> input(numValues), result(numValues);
+
+    for (size_t i = 0; i < (size_t) numValues; ++i)
+        input[i] = -12.0f + 24.0f * (float) i / (float) (numValues - 1);
+
+    for (auto x : { 0.0f, 1.0e-30f, 20.0f, 1.0e6f, std::numeric_limits<float>::max() })
+    {
+        input.push_back(x);
+        input.push_back(-x);
+    }
+
+    result.resize(input.size());
+    const auto numInputs = (int) input.size();
+
+    FastTanhTable::getInstance();
+
+    int numFailures = 0;
+
+    for (auto approximation : approximations)
+    {
+        // EXACT is the reference itself, up to float rounding
+        const auto maxError = jmax(maxErrors[approximation], 1.0e-6f);
+
+        // the largest error of one kernel, infinite if it left [-1, 1]
+        auto check = [&](const char* kernel)
+        {
+            float worstError = 0.0f, worstInput = 0.0f;
+
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                const auto error = std::abs(result[i]) > 1.0f ? std::numeric_limits<float>::infinity()
+                                                               : std::abs(result[i] - (float) std::tanh((double) input[i]));
+
+                if (! (error <= worstError))
+                {
+                    worstError = error;
+                    worstInput = input[i];
+                }
+            }
+
+            if (! (worstError <= maxError))
+            {
+                std::cerr << names[approximation] << " " << kernel << ": error " << worstError << " at x=" << worstInput
+                          << " exceeds " << maxError << std::endl;
+                ++numFailures;
+            }
+
+            return worstError;
+        };
+
+        const auto scalarTime = timeSeconds([&]
+        {
+            for (size_t i = 0; i < input.size(); ++i)
+                result[i] = FastTanh::process(approximation, input[i]);
+        });
+        const auto scalarError = check("scalar");
+
+        const auto stereoTime = timeSeconds([&]
+        {
+            for (size_t i = 0; i + 1 < input.size(); i += 2)
+            {
+                auto x = FastTanh::process(approximation, loadStereo(input[i], input[i + 1]));
+                storeStereo(x, result[i], result[i + 1]);
+            }
+        });
+        const auto stereoError = check("stereo");
+
+        std::copy(input.begin(), input.end(), result.begin());
+        const auto blockTime = timeSeconds([&]
+        {
+            FastTanh::processBlock(approximation, result.data(), numInputs);
+        });
+        const auto blockError = check("block");
+
+        std::cerr << names[approximation] << ": max error " << jmax(scalarError, stereoError, blockError) << ", "
+                  << scalarTime * 1.0e9 / numInputs << " ns/sample scalar, "
+                  << stereoTime * 1.0e9 / numInputs << " ns/sample stereo, "
+                  << blockTime * 1.0e9 / numInputs << " ns/sample block" << std::endl;
+    }
+
+    std::cerr << (numFailures == 0 ? "tanh check passed" : "tanh check FAILED") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}
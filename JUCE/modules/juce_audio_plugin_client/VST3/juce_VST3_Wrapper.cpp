@@ -2230,6 +2230,15 @@ public:
 
         comPluginInstance = VSTComSmartPtr<JuceAudioProcessor> { new JuceAudioProcessor (pluginInstance) };
 
+        if (auto* extensions = dynamic_cast<VST3ClientExtensions*> (pluginInstance))
+        {
+            if (extensions->wantsParameterChangePoints())
+                parameterChangePointReceiver = extensions;
+
+            if (extensions->wantsSilenceFlags())
+                silenceFlagsHandler = extensions;
+        }
+
         zerostruct (processContext);
 
         processSetup.maxSamplesPerBlock = 1024;
@@ -3068,7 +3077,7 @@ public:
     }
 
     //==============================================================================
-    void processParameterChanges (Vst::IParameterChanges& paramChanges)
+    void processParameterChanges (Vst::IParameterChanges& paramChanges, bool isProcessingAudio)
     {
         jassert (pluginInstance != nullptr);
 
@@ -3094,13 +3103,33 @@ public:
                    #endif
                     {
                         if (auto* param = comPluginInstance->getParamForVSTParamID (vstParamID))
+                        {
+                            // when the host only flushes parameters, there is no block for the points to land in
+                            if (parameterChangePointReceiver != nullptr && isProcessingAudio)
+                                reportParameterChangePoints (*paramQueue, *param);
+
                             setValueAndNotifyIfChanged (*param, (float) value);
+                        }
                     }
                 }
             }
         }
     }
 
+    void reportParameterChangePoints (Vst::IParamValueQueue& paramQueue, AudioProcessorParameter& param)
+    {
+        auto numPoints = paramQueue.getPointCount();
+
+        for (Steinberg::int32 point = 0; point < numPoints; ++point)
+        {
+            Steinberg::int32 offsetSamples = 0;
+            double value = 0.0;
+
+            if (paramQueue.getPoint (point, offsetSamples, value) == kResultTrue)
+                parameterChangePointReceiver->parameterChangePoint (param, (int) offsetSamples, (float) value);
+        }
+    }
+
     void addParameterChangeToMidiBuffer (const Steinberg::int32 offsetSamples, const Vst::ParamID id, const double value)
     {
         // If the parameter is mapped to a MIDI CC message then insert it into the midiBuffer.
@@ -3146,8 +3175,11 @@ public:
 
         midiBuffer.clear();
 
+        if (parameterChangePointReceiver != nullptr)
+            parameterChangePointReceiver->beginParameterChangePoints();
+
         if (data.inputParameterChanges != nullptr)
-            processParameterChanges (*data.inputParameterChanges);
+            processParameterChanges (*data.inputParameterChanges, data.numSamples > 0);
 
        #if JucePlugin_WantsMidiInput
         if (isMidiInputBusEnabled && data.inputEvents != nullptr)
@@ -3386,9 +3418,19 @@ private:
                     // processBlockBypassed should only ever be called if the AudioProcessor doesn't
                     // return a valid parameter from getBypassParameter
                     if (pluginInstance->getBypassParameter() == nullptr && comPluginInstance->getBypassParameter()->getValue() >= 0.5f)
+                    {
                         pluginInstance->processBlockBypassed (buffer, midiBuffer);
+                    }
                     else
+                    {
+                        if (silenceFlagsHandler != nullptr)
+                            silenceFlagsHandler->setInputSilenceFlags (data.numInputs > 0 ? (uint64) data.inputs[0].silenceFlags : 0);
+
                         pluginInstance->processBlock (buffer, midiBuffer);
+
+                        if (silenceFlagsHandler != nullptr && data.numOutputs > 0)
+                            data.outputs[0].silenceFlags = (Steinberg::uint64) silenceFlagsHandler->getOutputSilenceFlags();
+                    }
                 }
             }
 
@@ -3486,6 +3528,8 @@ private:
 
     std::atomic<int> refCount { 1 };
     AudioProcessor* pluginInstance = nullptr;
+    VST3ClientExtensions* parameterChangePointReceiver = nullptr;
+    VST3ClientExtensions* silenceFlagsHandler = nullptr;
 
    #if JUCE_LINUX || JUCE_BSD
     template <class T>
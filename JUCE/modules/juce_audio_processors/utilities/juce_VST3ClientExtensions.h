@@ -37,6 +37,8 @@ namespace Steinberg
 namespace juce
 {
 
+class AudioProcessorParameter;
+
 /** An interface to allow an AudioProcessor to implement extended VST3-specific
     functionality.
 
@@ -94,6 +96,55 @@ struct VST3ClientExtensions
         All other input buses will always be designated kAux.
     */
     virtual bool getPluginHasMainInput() const  { return true; }
+
+    /** Return true to have parameterChangePoint() called with every point of the
+        host's parameter automation queues. This is checked once, when the wrapper
+        is created.
+
+        Without it, only the last point of each queue is set on its parameter at
+        the start of the block. That still happens when this returns true, the
+        points are reported in addition to it.
+    */
+    virtual bool wantsParameterChangePoints() const  { return false; }
+
+    /** Called on the audio thread before each processBlock() for every point of
+        the parameter automation queues, if wantsParameterChangePoints() returned
+        true. The points of one parameter come in order, the sample offset being
+        relative to the start of the coming block; the last one is the value the
+        parameter is then set to.
+
+        This must not block or allocate.
+    */
+    virtual void parameterChangePoint (AudioProcessorParameter&, int /*sampleOffset*/, float /*newValue*/) {}
+
+    /** Called on the audio thread at the start of every process() call, before
+        its points are reported, if wantsParameterChangePoints() returned true.
+
+        processBlock() doesn't follow every call (the plugin can be suspended or
+        bypassed, or the host can only be flushing parameters), so the points
+        reported before the previous call that weren't used should be dropped here.
+
+        This must not block or allocate.
+    */
+    virtual void beginParameterChangePoints() {}
+
+    /** Return true to exchange the silence flags of the main buses with the host
+        through setInputSilenceFlags() and getOutputSilenceFlags(). This is checked
+        once, when the wrapper is created.
+    */
+    virtual bool wantsSilenceFlags() const  { return false; }
+
+    /** Called on the audio thread before each processBlock() with the silence flags
+        of the main input bus, bit n being set when the host knows channel n to be
+        silent.
+    */
+    virtual void setInputSilenceFlags (uint64 /*flags*/) {}
+
+    /** Called on the audio thread after each processBlock(), the result being passed
+        to the host as the silence flags of the main output bus. Only set the bits of
+        the channels that the block left entirely silent.
+    */
+    virtual uint64 getOutputSilenceFlags() const  { return 0; }
 };
 
 } // namespace juce
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 
 class BitModulation
 {
@@ -28,7 +33,113 @@ public:
         return [](float a, float) { return a; };
 	}
 
+	// Integer implementation of fp_xor/fp_and/fp_or, working straight on the IEEE-754 bit patterns.
+	// Same results as getOpFunc() for finite inputs, except that denormal inputs are treated as zero
+	// and that a zero result can come out with the opposite sign.
+	template <Operation operation>
+	static inline float process(float a, float b) noexcept
+	{
+		if (operation == Operation::NONE)
+			return a;
+
+		const uint32_t ua = toBits(a);
+		const uint32_t ub = toBits(b);
+
+		const int32_t sa = (int32_t) (ua >> 31);
+		const int32_t sb = (int32_t) (ub >> 31);
+		const int32_t ea = (int32_t) ((ua >> 23) & 0xff);
+		const int32_t eb = (int32_t) ((ub >> 23) & 0xff);
+
+		// 24 bit mantissas including the implicit bit, as ifrexp() gives them
+		const int32_t ma = ea != 0 ? (int32_t) ((ua & 0x7fffff) | 0x800000) : 0;
+		const int32_t mb = eb != 0 ? (int32_t) ((ub & 0x7fffff) | 0x800000) : 0;
+
+		// the operand with the larger exponent sets the scale, the other one is shifted down to it
+		const bool aIsBig = ea >= eb;
+		const int32_t eBig = aIsBig ? ea : eb;
+		const int32_t shift = std::min(aIsBig ? ea - eb : eb - ea, 31);
+		const int32_t mBig = aIsBig ? ma : mb;
+		const int32_t mSmall = aIsBig ? mb : ma;
+		const int32_t sBig = aIsBig ? sa : sb;
+		const int32_t sSmall = aIsBig ? sb : sa;
+
+		int32_t result = 0;
+		int32_t negate = 0;
+
+		if (operation == Operation::XOR)
+		{
+			result = mBig ^ (mSmall >> shift);
+			negate = sa ^ sb;
+		}
+		else
+		{
+			// masks, all ones when true
+			const int32_t bothNegative = -(sa & sb);
+			const int32_t bigNegative = -(sBig & (sSmall ^ 1));
+			const int32_t smallNegative = -(sSmall & (sBig ^ 1));
+
+			// a single negative operand takes part as the ones' complement of its magnitude,
+			// the small one being shifted as a negative number (rounding towards -inf)
+			const int32_t bigOperand = mBig ^ bigNegative;
+			const int32_t smallOperand = (((mSmall ^ smallNegative) - smallNegative) >> shift) + smallNegative;
+
+			const int32_t andBits = bigOperand & smallOperand;
+			const int32_t orBits = bigOperand | smallOperand;
+
+			// with both operands negative, AND turns into OR of the magnitudes and vice versa, then negated
+			if (operation == Operation::AND)
+				result = (orBits & bothNegative) | (andBits & ~bothNegative);
+			else
+				result = (andBits & bothNegative) | ((orBits + ((bigNegative | smallNegative) & 1)) & ~bothNegative);
+
+			negate = bothNegative & 1;
+		}
+
+		// result * 2^(eBig - 150), in two steps so that tiny results still round like the single multiply in and_/or_/xor_
+		const float scale = fromBits((uint32_t) (std::max(eBig, 24) - 23) << 23);
+		const float tinyScale = fromBits((uint32_t) (std::min(eBig, 24) + 103) << 23);
+
+		return fromBits(toBits((float) result * scale * tinyScale) ^ ((uint32_t) negate << 31));
+	}
+
+	template <Operation operation>
+	static void processBlock(const float* a, const float* b, float* dest, int numSamples) noexcept
+	{
+		for (int i = 0; i < numSamples; ++i)
+			dest[i] = process<operation>(a[i], b[i]);
+	}
+
+	// dest may be the same array as a or b
+	static void processBlock(Operation operation, const float* a, const float* b, float* dest, int numSamples) noexcept
+	{
+		switch (operation)
+		{
+			case Operation::XOR: processBlock<Operation::XOR>(a, b, dest, numSamples); break;
+			case Operation::AND: processBlock<Operation::AND>(a, b, dest, numSamples); break;
+			case Operation::OR:  processBlock<Operation::OR>(a, b, dest, numSamples); break;
+			case Operation::NONE:
+			default:
+				if (dest != a)
+					std::memmove(dest, a, (size_t) numSamples * sizeof(float));
+				break;
+		}
+	}
+
 private:
+	static inline uint32_t toBits(float x) noexcept
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+		return bits;
+	}
+
+	static inline float fromBits(uint32_t bits) noexcept
+	{
+		float x;
+		std::memcpy(&x, &bits, sizeof(x));
+		return x;
+	}
+
 	static inline std::pair<long long, int> ifrexp(float d)
 	{
 		int exp;
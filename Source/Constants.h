@@ -1,11 +1,14 @@
 #pragma once
 
 constexpr int MAX_DELAY_TIME_SEC = 2;
+constexpr float MAX_DELAY_TIME_LIMIT_SEC = 30.0f;
 constexpr int MIN_DELAY_TIME_SEC = 0.05f;
 
 constexpr float MIN_MOD_RATE_HZ = 0.02f;
 constexpr float MAX_MOD_RATE_HZ = 10.0f;
 
+constexpr float MAX_MOD_STEREO_PHASE_DEG = 180.0f;
+
 constexpr float MIN_GAIN_DB = -60.0f;
 constexpr float MAX_GAIN_DB = 0.0f;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ProcessorUtils.h"
 
 class DCBlocker
 {
@@ -32,3 +33,39 @@ private:
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DCBlocker)
 };
+
+class StereoDCBlocker
+{
+public:
+    StereoDCBlocker() {}
+    ~StereoDCBlocker() {}
+
+    void processBlock(float* left, float* right, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = loadStereo(left[i], right[i]);
+            auto y = x - xn1 + yn1 * coeff;
+            xn1 = x;
+            yn1 = y;
+            storeStereo(y, left[i], right[i]);
+        }
+    }
+
+    void reset(float sampleRate)
+    {
+        fs = sampleRate;
+        xn1 = 0.0f;
+        yn1 = 0.0f;
+    }
+
+private:
+    static constexpr float coeff = 0.995f;
+
+    float fs = 44100.0f;
+
+    StereoRegister xn1 { 0.0f };
+    StereoRegister yn1 { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoDCBlocker)
+};
\ No newline at end of file
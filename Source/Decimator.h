@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ProcessorUtils.h"
+
+// Sample and hold decimator, both channels in one register.
+// The right channel's phasor is shifted by the stereo spread.
+class StereoDecimator
+{
+public:
+    StereoDecimator() {}
+
+    void reset()
+    {
+        phasor = 0.0f;
+        currentOutput = 0.0f;
+    }
+
+    void processBlock(float* left, float* right, const float* reduction, const float* stereoSpread, int numSamples)
+    {
+        const auto one = StereoRegister::expand(1.0f);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            phasor += reduction[i];
+
+            const auto hold = StereoRegister::greaterThanOrEqual(phasor + loadStereo(0.0f, stereoSpread[i]), one);
+            phasor -= one & hold;
+            currentOutput = (loadStereo(left[i], right[i]) & hold) + (currentOutput & ~hold);
+
+            storeStereo(currentOutput, left[i], right[i]);
+        }
+    }
+
+private:
+    StereoRegister phasor { 0.0f };
+    StereoRegister currentOutput { 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoDecimator)
+};
@@ -1,273 +1,586 @@
 #include "DelayProcessor.h"
 
-inline float DelayProcessor::applyBitCrusher(float x, float depth)
+DelayProcessor::DelayProcessor()
 {
-    if (depth > MIN_BITCRUSHER_Q)
-        return depth * ((int)(x / depth));
+    parameters.setSmoothing(TIME_SMPLS, Smoothing::MULTIPLICATIVE, 0.25f, MIN_DELAY_SMPLS);
+    parameters.setSmoothing(FEEDBACK_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, 0.0f);
 
-    return x;
+    parameters.setSmoothing(MOD_RATE_HZ, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, MIN_MOD_RATE_HZ);
+    parameters.setSmoothing(MOD_DEPTH_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, 0.0f);
+    parameters.setSmoothing(MOD_STEREO_PHASE_CYCLES, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, 0.0f);
+
+    parameters.setSmoothing(NOISE_LEVEL_LIN, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, 0.001f);
+
+    parameters.setSmoothing(PHASE_FLIP, Smoothing::LINEAR, 0.01f, 1.0f);
+
+    parameters.setSmoothing(BC_DEPTH_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, 0.0f);
+
+    parameters.setSmoothing(DECIM_REDUCTION_LIN, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, 1.0f);
+    parameters.setSmoothing(DECIM_STEREO_SPREAD_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, 0.0f);
+
+    parameters.setSmoothing(LPF_CUTOFF_HZ, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, MAX_FILTER_CUTOFF_FREQ);
+    parameters.setSmoothing(LPF_Q_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, MIN_FILTER_Q);
+
+    parameters.setSmoothing(HPF_CUTOFF_HZ, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, MIN_FILTER_CUTOFF_FREQ);
+    parameters.setSmoothing(HPF_Q_LIN, Smoothing::LINEAR, SMOOTHED_VAL_RAMP_LEN_SEC, MIN_FILTER_Q);
+
+    parameters.setSmoothing(BM_LEVEL_LIN, Smoothing::MULTIPLICATIVE, SMOOTHED_VAL_RAMP_LEN_SEC, 0.01f);
+
+    updateKernels();
+}
+
+// kernel index = routing + 2 * tone + 4 * noise
+template <size_t... Index>
+constexpr std::array<DelayProcessor::SubBlockKernel, sizeof...(Index)> DelayProcessor::makeSubBlockKernels(std::index_sequence<Index...>)
+{
+    return { { &DelayProcessor::processSubBlock<static_cast<EffectsRouting>(Index % 2),
+                                                static_cast<ToneType>(Index / 2 % 2),
+                                                static_cast<NoiseType>(Index / 4)>... } };
 }
 
-inline float DelayProcessor::applyBitMod(float dry, float wet, float wetWithFx, float level)
+// kernel index = lpf position + 2 * hpf position + 4 * operation + 16 * operands
+template <size_t... Index>
+constexpr std::array<DelayProcessor::EffectsKernel, sizeof...(Index)> DelayProcessor::makeEffectsKernels(std::index_sequence<Index...>)
 {
-    if (bmOperation == BitModulation::Operation::NONE)
-        return wetWithFx;
+    return { { &DelayProcessor::applyEffects<static_cast<FilterPosition>(Index % 2),
+                                             static_cast<FilterPosition>(Index / 2 % 2),
+                                             static_cast<BitModulation::Operation>(Index / 4 % 4),
+                                             static_cast<BitModOperands>(Index / 16)>... } };
+}
+
+const std::array<DelayProcessor::SubBlockKernel, DelayProcessor::NUM_SUB_BLOCK_KERNELS> DelayProcessor::subBlockKernels
+    = DelayProcessor::makeSubBlockKernels(std::make_index_sequence<NUM_SUB_BLOCK_KERNELS>());
 
-    auto operand1 = 0.0f;
-    auto operand2 = 0.0f;
+const std::array<DelayProcessor::EffectsKernel, DelayProcessor::NUM_EFFECTS_KERNELS> DelayProcessor::effectsKernels
+    = DelayProcessor::makeEffectsKernels(std::make_index_sequence<NUM_EFFECTS_KERNELS>());
 
-    if (bmOperands == BitModOperands::POST_FX_POST_FX)
+void DelayProcessor::updateKernels()
+{
+    const auto subBlockIndex = (size_t) (effectsRouting + 2 * toneType + 4 * noiseType);
+
+    // the operands don't matter without a bit modulation, those blocks all share one kernel
+    const auto operands = bmOperation == BitModulation::Operation::NONE ? BitModOperands::POST_FX_POST_FX : bmOperands;
+    const auto effectsIndex = (size_t) (lpfPosition + 2 * hpfPosition + 4 * bmOperation + 16 * operands);
+
+    jassert(subBlockIndex < NUM_SUB_BLOCK_KERNELS && effectsIndex < NUM_EFFECTS_KERNELS);
+
+    subBlockKernel = subBlockKernels[subBlockIndex];
+    effectsKernel = effectsKernels[effectsIndex];
+}
+
+void DelayProcessor::applyBitCrusher(float* y, int numSamples)
+{
+    if (isBitCrusherNeutral())
+        return;
+
+    const auto* bcDepth = getLane(BC_DEPTH_LIN);
+
+    // written as a select, so the loop vectorises
+    for (int i = 0; i < numSamples; ++i)
     {
-        operand1 = operand2 = wetWithFx;
+        const auto crushed = bcDepth[i] * (float) ((int) (y[i] / bcDepth[i]));
+        y[i] = bcDepth[i] > MIN_BITCRUSHER_Q ? crushed : y[i];
     }
-    else if (bmOperands == BitModOperands::PRE_FX_POST_FX)
+}
+
+void DelayProcessor::applyLowPass(float* const* y, int numSamples)
+{
+    if (parameters.wasMoving(LPF_CUTOFF_HZ) || parameters.wasMoving(LPF_Q_LIN))
+        lpf.processBlock(y[0], y[1], getLane(LPF_CUTOFF_HZ), getLane(LPF_Q_LIN), numSamples, parameters.getControlInterval());
+    else
+        lpf.processBlock(y[0], y[1], numSamples);
+}
+
+void DelayProcessor::applyHighPass(float* const* y, int numSamples)
+{
+    if (parameters.wasMoving(HPF_CUTOFF_HZ) || parameters.wasMoving(HPF_Q_LIN))
+        hpf.processBlock(y[0], y[1], getLane(HPF_CUTOFF_HZ), getLane(HPF_Q_LIN), numSamples, parameters.getControlInterval());
+    else
+        hpf.processBlock(y[0], y[1], numSamples);
+}
+
+template <typename Process, typename Reset>
+void DelayProcessor::applyStage(StageBypass& bypass, bool isNeutral, float* const* y, int numSamples, Process&& process, Reset&& reset)
+{
+    const auto action = bypass.update(isNeutral);
+
+    if (action == StageBypass::SKIP)
+        return;
+
+    if (action == StageBypass::RESTART)
+        reset();
+
+    if (! bypass.isFading())
     {
-        operand1 = wet;
-        operand2 = wetWithFx;
+        process();
+        return;
     }
-    else if (bmOperands == BitModOperands::DRY_POST_FX)
+
+    float* input[NUM_CHANNELS];
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
     {
-        operand1 = dry;
-        operand2 = wetWithFx;
+        input[channel] = getLane(BYPASS_LANE, channel);
+        FloatVectorOperations::copy(input[channel], y[channel], numSamples);
     }
 
-    return bitModOpFunc(operand1, operand2 * level);
+    process();
+    bypass.crossfade(input, y, NUM_CHANNELS, numSamples);
+}
+
+template <BitModulation::Operation bmOp, DelayProcessor::BitModOperands operands>
+void DelayProcessor::applyBitMod(const float* dry, const float* wet, float* y, int channel, int numSamples)
+{
+    auto* operand2 = getLane(BITMOD_LANE, channel);
+    FloatVectorOperations::multiply(operand2, y, getLane(BM_LEVEL_LIN), numSamples);
+
+    // operand1 is y itself for POST_FX_POST_FX
+    const float* operand1 = y;
+    if (operands == BitModOperands::PRE_FX_POST_FX)
+        operand1 = wet;
+    else if (operands == BitModOperands::DRY_POST_FX)
+        operand1 = dry;
+
+    BitModulation::processBlock<bmOp>(operand1, operand2, y, numSamples);
 }
 
-inline float DelayProcessor::applyDecimator(float x, float reduction, float phasorShift, int channel)
+template <DelayProcessor::FilterPosition lpfPos, DelayProcessor::FilterPosition hpfPos,
+          BitModulation::Operation bmOp, DelayProcessor::BitModOperands operands>
+void DelayProcessor::applyEffects(const float* const* dry, const float* const* wet, float* const* y, int numSamples)
 {
-    decimPhasor[channel] += reduction;
-    if (decimPhasor[channel] + phasorShift >= 1.0f)
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        // phase
+        if (isStaticAt(PHASE_FLIP, 1.0f))
+            FloatVectorOperations::copy(y[channel], wet[channel], numSamples);
+        else
+            FloatVectorOperations::multiply(y[channel], wet[channel], getLane(PHASE_FLIP), numSamples);
+
+        applyBitCrusher(y[channel], numSamples);
+    }
+
+    auto decimate = [&] { decimator.processBlock(y[0], y[1], getLane(DECIM_REDUCTION_LIN), getLane(DECIM_STEREO_SPREAD_LIN), numSamples); };
+    auto lowPass = [&] { applyLowPass(y, numSamples); };
+    auto highPass = [&] { applyHighPass(y, numSamples); };
+    auto blockDC = [&] { dcBlocker.processBlock(y[0], y[1], numSamples); };
+
+    applyStage(decimatorBypass, isDecimatorNeutral(), y, numSamples, decimate, [&] { decimator.reset(); });
+
+    if (lpfPos == FilterPosition::PRE_BITMOD)
+        applyStage(lpfBypass, isLowPassNeutral(), y, numSamples, lowPass, [&] { lpf.reset(fs); });
+
+    if (hpfPos == FilterPosition::PRE_BITMOD)
+        applyStage(hpfBypass, isHighPassNeutral(), y, numSamples, highPass, [&] { hpf.reset(fs); });
+
+    if (bmOp != BitModulation::Operation::NONE)
     {
-        decimPhasor[channel] -= 1.0f;
-        decimCurrentOutput[channel] = x;
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            applyBitMod<bmOp, operands>(dry[channel], wet[channel], y[channel], channel, numSamples);
     }
-    return decimCurrentOutput[channel];
+
+    const auto isDCBlockerNeutral = bmOp == BitModulation::Operation::NONE && isBitCrusherNeutral();
+    applyStage(dcBlockerBypass, isDCBlockerNeutral, y, numSamples, blockDC, [&] { dcBlocker.reset(fs); });
+
+    if (lpfPos == FilterPosition::POST_BITMOD)
+        applyStage(lpfBypass, isLowPassNeutral(), y, numSamples, lowPass, [&] { lpf.reset(fs); });
+
+    if (hpfPos == FilterPosition::POST_BITMOD)
+        applyStage(hpfBypass, isHighPassNeutral(), y, numSamples, highPass, [&] { hpf.reset(fs); });
+}
+
+void DelayProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    const auto newSubBlockSize = jlimit(1, MAX_SUB_BLOCK_SIZE, samplesPerBlock);
+    const auto newRequestedTime_smpls = jlimit(MIN_DELAY_SMPLS, maxDelayTime_sec * (float) sampleRate, requestedTime_smpls);
+    const auto initialDelay_smpls = jmax(newRequestedTime_smpls, MIN_DELAY_LINE_SEC * (float) sampleRate)
+                                    + MAX_MOD_DEPTH_SECS * (float) sampleRate;
+
+    // Hosts prepare again on transport and graph changes. When nothing the memory depends on has changed, it is kept
+    // and only what the delay lines were written gets cleared.
+    const auto canKeepMemory = isPrepared && (float) sampleRate == fs && newSubBlockSize == subBlockSize
+                               && delayStorage == delayLine.getStorage() && maxDelayTime_sec == preparedMaxDelayTime_sec
+                               && shouldLockMemory == preparedWithLock && initialDelay_smpls <= (float) delayLine.getMaxDelay();
+
+    fs = (float) sampleRate;
+    subBlockSize = newSubBlockSize;
+    maxModDepth_smpls = MAX_MOD_DEPTH_SECS * fs;
+    requestedTime_smpls = newRequestedTime_smpls;
+
+    if (canKeepMemory)
+        delayLine.reset();
+    else
+        allocate(initialDelay_smpls);
+
+    updateTime();
+
+    if (! tailSnapshot.isEmpty() && tailSnapshotSampleRate == fs)
+        delayLine.restoreSnapshot(tailSnapshot);
+
+    tailSnapshot.clear();
+
+    parameters.prepare(fs, subBlockSize, parameterLanes);
+
+    FastTanhTable::getInstance();
+
+    tapeDelayBandpass.reset(fs);
+    tapeDelayBandpass.setParameters(725.0f, 0.33f, false, false, 0.0f, 1.0f, 0.0f, 0.0f, false);
+
+    delayHiPass.reset(fs);
+    delayHiPass.setParameters(100.0f, 0.707f, false, false, 0.0f, 0.0f, 1.0f, 0.0f, false);
+
+    modLfo.reset(fs);
+
+    decimator.reset();
+
+    hpf.reset(fs);
+    hpf.setParameters(parameters.getCurrentValue(HPF_CUTOFF_HZ), parameters.getCurrentValue(HPF_Q_LIN), false, false, 0.0f, 0.0f,
+                      1.0f, 0.0f, false);
+
+    lpf.reset(fs);
+    lpf.setParameters(parameters.getCurrentValue(LPF_CUTOFF_HZ), parameters.getCurrentValue(LPF_Q_LIN), false, false, 0.0f, 0.0f,
+                      0.0f, 1.0f, false);
+
+    dcBlocker.reset(fs);
+
+    decimatorBypass.reset(fs);
+    lpfBypass.reset(fs);
+    hpfBypass.reset(fs);
+    dcBlockerBypass.reset(fs);
+
+    whiteNoiseGen.reset(fs);
+    brownianNoiseGen.reset(fs);
+    pinkNoiseGen.reset(fs);
+
+    isIdle = false;
+    numSilentSamples = 0;
+    numIdleSamples = 0;
+    updateTailLength();
+
+    preparedMaxDelayTime_sec = maxDelayTime_sec;
+    preparedWithLock = shouldLockMemory;
+    isPrepared = true;
 }
 
-inline float DelayProcessor::applyEffects(float xDry, float xWet, float phaseFlipSmoothed, float bcDepth, float decimReduction, float decimStereoSpread, float bmLevel, int channel)
+void DelayProcessor::allocate(float initialDelay_smpls)
 {
-    auto y = xWet;
+    // the thread that grows the delay lines stops before the arena gets replaced
+    delayLine.release();
+
+    DspArena::Layout layout;
+    size_t scratchOffsets[NUM_CHANNELS * NUM_CHANNEL_LANES];
+    size_t parameterLaneOffsets[NUM_SMOOTHED_PARAMETERS];
+    size_t delayLineOffsets[NUM_CHANNELS];
+
+    for (auto& offset : scratchOffsets)
+        offset = layout.add<float>((size_t) subBlockSize);
+
+    for (auto& offset : parameterLaneOffsets)
+        offset = layout.add<float>((size_t) subBlockSize);
 
-    // phase
-    y *= phaseFlipSmoothed;
+    for (auto& offset : delayLineOffsets)
+        offset = layout.add<char>(StereoDelayLine::getLineMemorySize(initialDelay_smpls, delayStorage));
 
-    // bit crusher
-    if (bcDepth > MIN_BITCRUSHER_Q)
-        y = bcDepth * ((int)(y / bcDepth));
+    arena.allocate(layout, shouldLockMemory);
 
-    // decimator
-    decimPhasor[channel] += decimReduction;
-    auto stereoPhaseShift = channel == 0 ? 0.0f : decimStereoSpread;
-    if (decimPhasor[channel] + stereoPhaseShift >= 1.0f)
+    for (int lane = 0; lane < NUM_CHANNELS * NUM_CHANNEL_LANES; ++lane)
+        scratch[lane] = arena.get<float>(scratchOffsets[lane]);
+
+    for (int index = 0; index < NUM_SMOOTHED_PARAMETERS; ++index)
+        parameterLanes[index] = arena.get<float>(parameterLaneOffsets[index]);
+
+    void* delayLineMemory[NUM_CHANNELS];
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        delayLineMemory[channel] = arena.get<char>(delayLineOffsets[channel]);
+
+    delayLine.prepare(initialDelay_smpls, maxDelayTime_sec * fs + maxModDepth_smpls, delayStorage, delayLineMemory, shouldLockMemory);
+}
+
+void DelayProcessor::releaseResources(bool keepTail)
+{
+    tailSnapshot.clear();
+
+    // an idle processor has nothing left in its delay lines
+    if (keepTail && isPrepared && ! isIdle)
     {
-        decimPhasor[channel] -= 1.0f;
-        decimCurrentOutput[channel] = y;
+        const auto reach = jmax(parameters.getCurrentValue(TIME_SMPLS), parameters.getTargetValue(TIME_SMPLS)) + maxModDepth_smpls;
+
+        delayLine.takeSnapshot(tailSnapshot, (int) std::ceil(reach) + CircularBuffer::MAX_TAPS_AHEAD, SILENCE_THRESHOLD);
+        tailSnapshotSampleRate = fs;
     }
-    y = decimCurrentOutput[channel];
 
-    // LPF if PRE_BITMOD
-    if (lpfPosition == FilterPosition::PRE_BITMOD)
+    delayLine.release();
+    arena.release();
+
+    for (auto& lane : scratch)
+        lane = nullptr;
+
+    for (auto& lane : parameterLanes)
+        lane = nullptr;
+
+    isPrepared = false;
+}
+
+template <DelayProcessor::NoiseType noise>
+void DelayProcessor::renderNoise(int numSamples)
+{
+    auto* left = getLane(NOISE_LANE, 0);
+    auto* right = getLane(NOISE_LANE, 1);
+
+    if (! isNoiseAudible())
     {
-        y = lpf[channel].processSample(y);
+        FloatVectorOperations::clear(left, numSamples);
+        FloatVectorOperations::clear(right, numSamples);
+        return;
     }
-    // HPF if PRE_BITMOD
-    if (hpfPosition == FilterPosition::PRE_BITMOD)
+
+    if (noise == NoiseType::WHITE)
+        whiteNoiseGen.processBlock(left, right, numSamples);
+    else if (noise == NoiseType::BROWNIAN)
+        brownianNoiseGen.processBlock(left, right, numSamples);
+    else
+        pinkNoiseGen.processBlock(left, right, numSamples);
+
+    // the noise is muted below -60 dB
+    const auto* noiseLevel = getLane(NOISE_LEVEL_LIN);
+
+    for (int i = 0; i < numSamples; ++i)
     {
-        y = hpf[channel].processSample(y);
+        left[i] = noiseLevel[i] > 0.001f ? left[i] * noiseLevel[i] : 0.0f;
+        right[i] = noiseLevel[i] > 0.001f ? right[i] * noiseLevel[i] : 0.0f;
     }
+}
 
-    // bit modulation
-    if (bmOperation != BitModulation::Operation::NONE)
-    {
-        auto operand1 = 0.0f;
-        auto operand2 = 0.0f;
+void DelayProcessor::renderModulation(int numSamples)
+{
+    auto* left = getLane(MOD_LANE, 0);
+    auto* right = getLane(MOD_LANE, 1);
 
-        if (bmOperands == BitModOperands::POST_FX_POST_FX)
-        {
-            operand1 = operand2 = y;
-        }
-        else if (bmOperands == BitModOperands::PRE_FX_POST_FX)
-        {
-            operand1 = xWet;
-            operand2 = y;
-        }
-        else if (bmOperands == BitModOperands::DRY_POST_FX)
-        {
-            operand1 = xDry;
-            operand2 = y;
-        }
-        y = bitModOpFunc(operand1, operand2 * bmLevel);
-    }
-    y = dcBlocker[channel].processSample(y);
+    const auto* modRate = getLane(MOD_RATE_HZ);
+    const auto* stereoPhase = getLane(MOD_STEREO_PHASE_CYCLES);
+
+    // The LFO runs at full depth, the depth lane scales it afterwards.
+    // While the rate or the stereo phase move, the LFO follows them at the control rate.
+    const bool isMoving = parameters.wasMoving(MOD_RATE_HZ) || parameters.wasMoving(MOD_STEREO_PHASE_CYCLES);
+    const int segmentLength = isMoving ? parameters.getControlInterval() : numSamples;
 
-    // LPF if POST_BITMOD
-    if (lpfPosition == FilterPosition::POST_BITMOD)
+    for (int start = 0; start < numSamples; start += segmentLength)
     {
-        y = lpf[channel].processSample(y);
+        const int end = jmin(start + segmentLength, numSamples);
+
+        // the values in the middle of the segment keep the phase from drifting against a per sample update
+        const int middle = (start + end) / 2;
+        modLfo.setParams(modRate[middle], 1.0f, modWave, FastMathLFO::LFOPolarity::UNIPOLAR);
+        modLfo.processBlock(left + start, right + start, end - start, stereoPhase[middle]);
     }
-    // HPF if POST_BITMOD
-    if (hpfPosition == FilterPosition::POST_BITMOD)
+
+    // only the offsets, the delay line adds them to the time with its own precision
+    for (auto* y : { left, right })
     {
-        y = hpf[channel].processSample(y);
+        FloatVectorOperations::multiply(y, getLane(MOD_DEPTH_LIN), numSamples);
+        FloatVectorOperations::multiply(y, maxModDepth_smpls, numSamples);
     }
-
-    return y;
 }
 
-void DelayProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+void DelayProcessor::readDelayLine(int channel, int numSamples)
 {
-    fs = (float) sampleRate;
+    auto* y = getLane(LINE_LANE, channel);
 
-    maxModDepth_smpls = MAX_MOD_DEPTH_SECS * fs;
+    delayLine.readBlock(channel, getLane(TIME_SMPLS), getLane(MOD_LANE, channel), y, numSamples, delayInterpolation);
+    FloatVectorOperations::add(y, getLane(NOISE_LANE, channel), numSamples);
+}
 
-    time_smpls.reset(fs, 0.25f);
-    feedback_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+template <DelayProcessor::ToneType tone>
+void DelayProcessor::applyTone(float* const* x, int numSamples)
+{
+    if (tone != ToneType::TAPE)
+        return;
 
-    modRate_Hz.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
-    modDepth_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        FastTanh::processBlock(softClipperApproximation, x[channel], numSamples);
 
-    noiseLevel_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    tapeDelayBandpass.processBlock(x[0], x[1], numSamples);
 
-    smoothedPhaseFlip.reset(fs, 0.01f);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        FloatVectorOperations::multiply(x[channel], TAPE_DEL_LOOP_GAIN, numSamples);
+}
 
-    bcDepth_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+void DelayProcessor::writeDelayLines(const float* const* dry, float* const* x, int numSamples)
+{
+    const auto* fb = getLane(FEEDBACK_LIN);
+    float* y[NUM_CHANNELS];
 
-    decimReduction_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
-    decimStereoSpread_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        y[channel] = getLane(WRITE_LANE, channel);
+        FloatVectorOperations::copy(y[channel], x[channel], numSamples);
+    }
 
-    lpfCutoff_Hz.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
-    lpfQ_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    delayHiPass.processBlock(y[0], y[1], numSamples);
 
-    hpfCutoff_Hz.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
-    hpfQ_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            y[channel][i] = dry[channel][i] + fb[i] * y[channel][i];
+    }
 
-    bmLevel_lin.reset(fs, SMOOTHED_VAL_RAMP_LEN_SEC);
+    delayLine.writeBlock(y, numSamples);
+}
+
+template <DelayProcessor::EffectsRouting routing, DelayProcessor::ToneType tone, DelayProcessor::NoiseType noise>
+void DelayProcessor::processSubBlock(float* const* x, int numChannels, int numSamples)
+{
+    float* line[NUM_CHANNELS];
+    float* fx[NUM_CHANNELS];
 
     for (int channel = 0; channel < NUM_CHANNELS; ++channel)
     {
-        delayBuffer[channel].createCircularBuffer(static_cast<int>(fs) * MAX_DELAY_TIME_SEC);
-
-        tapeDelayBandpass[channel].reset(fs);
-        tapeDelayBandpass[channel].setParameters(725.0f, 0.33f, false, false, 0.0f, 1.0f, 0.0f, 0.0f, false);
+        line[channel] = getLane(LINE_LANE, channel);
+        fx[channel] = getLane(FX_LANE, channel);
+    }
 
-        delayHiPass[channel].reset(fs);
-        delayHiPass[channel].setParameters(100.0f, 0.707f, false, false, 0.0f, 0.0f, 1.0f, 0.0f, false);
+    renderNoise<noise>(numSamples);
+    renderModulation(numSamples);
 
-        modLfo[channel].reset(fs);
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        readDelayLine(channel, numSamples);
 
-        decimPhasor[channel] = 0.0f;
-        decimCurrentOutput[channel] = 0.0f;
+    if (routing == EffectsRouting::IN)
+    {
+        (this->*effectsKernel)(x, line, fx, numSamples);
+        std::swap(line, fx);
+    }
 
-        hpf[channel].reset(fs);
-        hpf[channel].setParameters(hpfCutoff_Hz.getCurrentValue(), hpfQ_lin.getTargetValue(), false, false, 0.0f, 0.0f,
-                                   1.0f, 0.0f, false);
+    applyTone<tone>(line, numSamples);
+    writeDelayLines(x, line, numSamples);
 
-        lpf[channel].reset(fs);
-        lpf[channel].setParameters(lpfCutoff_Hz.getCurrentValue(), lpfQ_lin.getTargetValue(), false, false, 0.0f, 0.0f,
-                                   0.0f, 1.0f, false);
+    float** out = line;
 
-        dcBlocker[channel].reset(fs);
+    if (routing == EffectsRouting::OUT)
+    {
+        (this->*effectsKernel)(x, line, fx, numSamples);
+        out = fx;
     }
 
-    whiteNoiseGen.reset(fs);
-    brownianNoiseGen.reset(fs);
+    for (int channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::copy(x[channel], out[channel], numSamples);
 }
 
 void DelayProcessor::processBlock(AudioBuffer<float> &buffer)
+{
+    processBlock(buffer, 0, buffer.getNumSamples());
+}
+
+void DelayProcessor::processBlock(AudioBuffer<float>& buffer, int startSample, int numSamples)
 {
     const int numChannels = jmin(buffer.getNumChannels(), NUM_CHANNELS);
-    const int numSamples = buffer.getNumSamples();
 
-    for (int sample = 0; sample < numSamples; ++sample)
+    if (numChannels == 0)
+        return;
+
+    jassert(startSample >= 0 && startSample + numSamples <= buffer.getNumSamples());
+
+    if (delayLine.update(numSamples))
+        updateTime();
+
+    for (int offset = startSample; offset < startSample + numSamples; offset += subBlockSize)
     {
-        const float delay = time_smpls.getNextValue();
-        const float fb = feedback_lin.getNextValue();
-        
-        bool modValsSmoothing = modRate_Hz.isSmoothing() || modDepth_lin.isSmoothing();
-        const float modRate = modRate_Hz.getNextValue();
-        const float modDepth = modDepth_lin.getNextValue();
-
-        auto noiseLvl = noiseLevel_lin.getNextValue();
-        float delayNoise = 0.0f;
-        if (noiseLvl > 0.001f)
+        const int n = jmin(subBlockSize, startSample + numSamples - offset);
+
+        // a mono buffer feeds both lanes of the stereo kernels, the right one is then discarded
+        float* x[NUM_CHANNELS];
+
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            x[channel] = buffer.getWritePointer(jmin(channel, numChannels - 1), offset);
+
+        const bool inputIsSilent = inputIsKnownSilent || isSilent(x, numChannels, n);
+
+        parameters.render(n);
+
+        if (isIdle)
         {
-            if (noiseType == NoiseType::WHITE)
-            {
-                delayNoise = whiteNoiseGen.nextValue();
-            }
-            else if (noiseType == NoiseType::BROWNIAN)
-            {
-                delayNoise = brownianNoiseGen.nextValue();
-            }
-            else if (noiseType == NoiseType::PINK)
+            if (inputIsSilent && ! isNoiseAudible())
             {
-                // TODO
+                for (int channel = 0; channel < numChannels; ++channel)
+                    FloatVectorOperations::clear(x[channel], n);
+
+                numIdleSamples += n;
+                continue;
             }
-            delayNoise *= noiseLvl;
+
+            isIdle = false;
         }
 
-        const float phaseFlipSmoothed = smoothedPhaseFlip.getNextValue();
+        (this->*subBlockKernel)(x, numChannels, n);
+        updateSilence(inputIsSilent, x, numChannels, n);
+    }
+}
 
-        const float bcDepth = bcDepth_lin.getNextValue();
+bool DelayProcessor::isSilent(const float* const* x, int numChannels, int numSamples)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const auto range = FloatVectorOperations::findMinAndMax(x[channel], numSamples);
 
-        const float decimReduction = decimReduction_lin.getNextValue();
-        const float decimStereoSpread = decimStereoSpread_lin.getNextValue();
+        if (range.getStart() < -SILENCE_THRESHOLD || range.getEnd() > SILENCE_THRESHOLD)
+            return false;
+    }
 
-        bool hpfValsSmoothing = hpfCutoff_Hz.isSmoothing() || hpfQ_lin.isSmoothing();
-        const float hpfCutoff = hpfCutoff_Hz.getNextValue();
-        const float hpfQ = hpfQ_lin.getNextValue();
+    return true;
+}
 
-        bool lpfValsSmoothing = lpfCutoff_Hz.isSmoothing() || lpfQ_lin.isSmoothing();
-        const float lpfCutoff = lpfCutoff_Hz.getNextValue();
-        const float lpfQ = lpfQ_lin.getNextValue();
+void DelayProcessor::updateSilence(bool inputIsSilent, const float* const* x, int numChannels, int numSamples)
+{
+    numIdleSamples = 0;
 
-        const float bmLevel = bmLevel_lin.getNextValue();
-        
-        for (int channel = 0; channel < numChannels; ++channel)
-        {
-            float* xPtr = buffer.getWritePointer(channel, sample);
-            float x = *xPtr;
+    const float* written[NUM_CHANNELS];
 
-            if (modValsSmoothing)
-            {
-                modLfo[channel].setParams(modRate, modDepth, modWave, FastMathLFO::LFOPolarity::UNIPOLAR);
-            }
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        written[channel] = getLane(WRITE_LANE, channel);
 
-            if (lpfValsSmoothing)
-            {
-                lpf[channel].setParameters(lpfCutoff, lpfQ, false, false, 0.0f, 0.0f, 0.0f, 1.0f, false);
-            }
-            if (hpfValsSmoothing)
-            {
-                hpf[channel].setParameters(hpfCutoff, hpfQ, false, false, 0.0f, 0.0f, 1.0f, 0.0f, false);
-            }
-            
-            auto modDepthSmpls = modLfo[channel].getNextSample(0.0f) * maxModDepth_smpls;
-            auto delayLineOut = delayBuffer[channel].readBuffer(delay + modDepthSmpls);
-            delayLineOut += delayNoise;
+    if (! inputIsSilent || isNoiseAudible() || ! isSilent(x, numChannels, numSamples) || ! isSilent(written, NUM_CHANNELS, numSamples))
+    {
+        numSilentSamples = 0;
+        return;
+    }
 
-            if (effectsRouting == EffectsRouting::IN)
-            {
-                delayLineOut = applyEffects(x, delayLineOut, phaseFlipSmoothed, bcDepth, decimReduction, decimStereoSpread, bmLevel, channel);
-            }
+    // whatever the delay lines still hold is below the threshold once a whole line was written silent
+    numSilentSamples += numSamples;
 
-            if (toneType == ToneType::TAPE)
-            {
-                delayLineOut = softClipper(delayLineOut);
-                delayLineOut = TAPE_DEL_LOOP_GAIN * tapeDelayBandpass[channel].processSample(delayLineOut);
-            }
+    if (numSilentSamples >= delayLine.getLength())
+        isIdle = true;
+}
 
-            auto dlHpfOut = delayHiPass[channel].processSample(delayLineOut);
+void DelayProcessor::updateTime()
+{
+    delayLine.requestDelay(requestedTime_smpls + maxModDepth_smpls);
+    parameters.setTargetValue(TIME_SMPLS, jmin(requestedTime_smpls, (float) delayLine.getMaxDelay() - maxModDepth_smpls));
+    updateTailLength();
+}
 
-            delayBuffer[channel].writeBuffer(x + fb * dlHpfOut);
+void DelayProcessor::updateTailLength()
+{
+    auto loopGain = parameters.getTargetValue(FEEDBACK_LIN);
 
-            if (effectsRouting == EffectsRouting::OUT)
-            {
-                delayLineOut = applyEffects(x, delayLineOut, phaseFlipSmoothed, bcDepth, decimReduction, decimStereoSpread, bmLevel, channel);
-            }
-            
-            *xPtr = delayLineOut;
-        }
+    if (toneType == ToneType::TAPE)
+        loopGain *= TAPE_LOOP_PEAK_GAIN;
+
+    // the resonance of the filters, when they are in the loop
+    if (effectsRouting == EffectsRouting::IN)
+        loopGain *= jmax(1.0f, parameters.getTargetValue(LPF_Q_LIN)) * jmax(1.0f, parameters.getTargetValue(HPF_Q_LIN));
+
+    const auto noiseIsOn = parameters.getTargetValue(NOISE_LEVEL_LIN) > 0.001f;
+
+    if (noiseIsOn || loopGain >= 1.0f)
+    {
+        tailLength_sec.store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+        return;
     }
+
+    const auto period_sec = (parameters.getTargetValue(TIME_SMPLS) + parameters.getTargetValue(MOD_DEPTH_LIN) * maxModDepth_smpls) / fs;
+
+    // the first repeat, then as many as it takes the loop to bring it down to the threshold
+    const auto numRepeats = loopGain > SILENCE_THRESHOLD ? 1.0 + std::ceil(std::log(SILENCE_THRESHOLD) / std::log(loopGain)) : 1.0;
+
+    tailLength_sec.store(period_sec * numRepeats + FILTER_RING_SEC, std::memory_order_relaxed);
 }
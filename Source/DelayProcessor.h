@@ -5,8 +5,13 @@
 #include "BitModulation.h"
 #include "Constants.h"
 #include "DCBlocker.h"
+#include "Decimator.h"
+#include "DspArena.h"
+#include "FastTanh.h"
 #include "NoiseGenerator.h"
+#include "ParameterBank.h"
 #include "ProcessorUtils.h"
+#include "StereoDelayLine.h"
 #include "VASVFilter.h"
 
 using namespace juce;
@@ -14,7 +19,7 @@ using namespace juce;
 class DelayProcessor
 {
 public:
-    DelayProcessor() {}
+    DelayProcessor();
     ~DelayProcessor() {}
 
     enum ToneType
@@ -49,56 +54,93 @@ public:
         DRY_POST_FX
     };
 
+    // Allocates the memory of the processing and clears its state. Called again with the same sample rate, block size
+    // and memory settings, it keeps the memory and only clears what was played since.
     void prepareToPlay(double sampleRate, int samplesPerBlock);
+
+    // Frees the memory of the processing until the next prepareToPlay(). With keepTail, what the delay lines still
+    // hold is kept in a compact snapshot first (see StereoDelayLine::Snapshot), which the next prepareToPlay() at the
+    // same sample rate writes back.
+    void releaseResources(bool keepTail);
+
     void processBlock(AudioBuffer<float>& buffer);
+    void processBlock(AudioBuffer<float>& buffer, int startSample, int numSamples);
+
+    // One setter per parameter, so that a change only touches what depends on it. The enum setters pick the kernels
+    // again, which is cheap. Levels are taken as gains, the dB conversion happens wherever the parameter changed.
+    void setTime(float time_ms) { requestedTime_smpls = jlimit(MIN_DELAY_SMPLS, maxDelayTime_sec * fs, time_ms * 0.001f * fs); updateTime(); }
+    void setFeedback(float feedback_pct) { parameters.setTargetValue(FEEDBACK_LIN, feedback_pct * 0.01f); updateTailLength(); }
+    void setToneType(int _toneType) { toneType = static_cast<ToneType>(_toneType); updateKernels(); updateTailLength(); }
+
+    void setModRate(float modRate_Hz) { parameters.setTargetValue(MOD_RATE_HZ, jmax(MIN_MOD_RATE_HZ, modRate_Hz)); }
+    void setModDepth(float modDepth_pct) { parameters.setTargetValue(MOD_DEPTH_LIN, modDepth_pct * 0.01f); updateTailLength(); }
+    void setModWave(int _modWave) { modWave = static_cast<FastMathLFO::LFOWave>(_modWave); }
+
+    // how far the right channel's modulation runs ahead of the left one's, 0 to 180 degrees
+    void setModStereoPhase(float degrees)
+    {
+        parameters.setTargetValue(MOD_STEREO_PHASE_CYCLES, jlimit(0.0f, MAX_MOD_STEREO_PHASE_DEG, degrees) / 360.0f);
+    }
+
+    void setNoiseLevel(float noiseLevel_lin) { parameters.setTargetValue(NOISE_LEVEL_LIN, noiseLevel_lin); updateTailLength(); }
+    void setNoiseType(int _noiseType) { noiseType = static_cast<NoiseType>(_noiseType); updateKernels(); }
+
+    void setEffectsRouting(int _effectsRouting) { effectsRouting = static_cast<EffectsRouting>(_effectsRouting); updateKernels(); updateTailLength(); }
+    void setFlipPhase(bool flipPhase) { parameters.setTargetValue(PHASE_FLIP, flipPhase ? -1.0f : 1.0f); }
+    void setBcDepth(float bcDepth_lin) { parameters.setTargetValue(BC_DEPTH_LIN, bcDepth_lin); }
+
+    void setDecimReduction(float decimReduction_lin) { parameters.setTargetValue(DECIM_REDUCTION_LIN, jmax(MIN_DECIMATOR_RATIO, decimReduction_lin)); }
+    void setDecimStereoSpread(float decimStereoSpread_lin) { parameters.setTargetValue(DECIM_STEREO_SPREAD_LIN, decimStereoSpread_lin); }
+
+    void setLpfCutoff(float lpfCutoff_Hz) { parameters.setTargetValue(LPF_CUTOFF_HZ, lpfCutoff_Hz); }
+    void setLpfQ(float lpfQ_lin) { parameters.setTargetValue(LPF_Q_LIN, lpfQ_lin); updateTailLength(); }
+    void setLpfPosition(int _lpfPosition) { lpfPosition = static_cast<FilterPosition>(_lpfPosition); updateKernels(); }
 
+    void setHpfCutoff(float hpfCutoff_Hz) { parameters.setTargetValue(HPF_CUTOFF_HZ, hpfCutoff_Hz); }
+    void setHpfQ(float hpfQ_lin) { parameters.setTargetValue(HPF_Q_LIN, hpfQ_lin); updateTailLength(); }
+    void setHpfPosition(int _hpfPosition) { hpfPosition = static_cast<FilterPosition>(_hpfPosition); updateKernels(); }
+
+    void setBmLevel(float bmLevel_lin) { parameters.setTargetValue(BM_LEVEL_LIN, bmLevel_lin); }
+    void setBmOperation(int _bmOperation) { bmOperation = static_cast<BitModulation::Operation>(_bmOperation); updateKernels(); }
+    void setBmOperands(int _bmOperands) { bmOperands = static_cast<BitModOperands>(_bmOperands); updateKernels(); }
+
+    // all delay or all effects parameters at once, with the levels in dB
     void setDelayParameters(float time_ms, float feedback_pct, int _toneType, float _modRate_Hz, float modDepth_pct, int _modWave, float _noiseLevel_dB, int _noiseType)
     {
-        time_smpls.setTargetValue(jmax(MIN_DELAY_SMPLS, time_ms * 0.001f * fs));
-        feedback_lin.setTargetValue(feedback_pct * 0.01f);
-        toneType = static_cast<ToneType>(_toneType);
+        setTime(time_ms);
+        setFeedback(feedback_pct);
+        setToneType(_toneType);
 
-        modRate_Hz.setTargetValue(jmax(MIN_MOD_RATE_HZ, _modRate_Hz));
-        modDepth_lin.setTargetValue(modDepth_pct * 0.01f);
-        modWave = static_cast<FastMathLFO::LFOWave>(_modWave);
+        setModRate(_modRate_Hz);
+        setModDepth(modDepth_pct);
+        setModWave(_modWave);
 
-        if (noiseLevel_dB != _noiseLevel_dB)
-        {
-            noiseLevel_dB = _noiseLevel_dB;
-            noiseLevel_lin.setTargetValue(Decibels::decibelsToGain(noiseLevel_dB));
-        }
-        noiseType = static_cast<NoiseType>(_noiseType);
+        setNoiseLevel(Decibels::decibelsToGain(_noiseLevel_dB));
+        setNoiseType(_noiseType);
     }
 
     void setEffectsParameters(int _effectsRouting, bool _flipPhase, float _bcDepth_lin, float _decimReduction_lin,
                               float _decimStereoSpread_lin, float _lpfCutoff_Hz, float _lpfQ_lin, int _lpfPosition,
                               float _bmLevel_dB, int _bmOperation, int _bmOperands, float _hpfCutoff_Hz, float _hpfQ_lin, int _hpfPosition)
     {
+        setEffectsRouting(_effectsRouting);
+        setFlipPhase(_flipPhase);
+        setBcDepth(_bcDepth_lin);
 
-        effectsRouting = static_cast<EffectsRouting>(_effectsRouting);
-
-        smoothedPhaseFlip.setTargetValue(_flipPhase ? -1.0f : 1.0f);
+        setDecimReduction(_decimReduction_lin);
+        setDecimStereoSpread(_decimStereoSpread_lin);
 
-        bcDepth_lin.setTargetValue(_bcDepth_lin);
+        setLpfCutoff(_lpfCutoff_Hz);
+        setLpfQ(_lpfQ_lin);
+        setLpfPosition(_lpfPosition);
 
-        decimReduction_lin.setTargetValue(jmax(MIN_DECIMATOR_RATIO, _decimReduction_lin));
-        decimStereoSpread_lin.setTargetValue(_decimStereoSpread_lin);
+        setHpfCutoff(_hpfCutoff_Hz);
+        setHpfQ(_hpfQ_lin);
+        setHpfPosition(_hpfPosition);
 
-        lpfCutoff_Hz.setTargetValue(_lpfCutoff_Hz);
-        lpfQ_lin.setTargetValue(_lpfQ_lin);
-        lpfPosition = static_cast<FilterPosition>(_lpfPosition);
-
-        hpfCutoff_Hz.setTargetValue(_hpfCutoff_Hz);
-        hpfQ_lin.setTargetValue(_hpfQ_lin);
-        hpfPosition = static_cast<FilterPosition>(_hpfPosition);
-
-        if (bmLevel_dB != _bmLevel_dB) {
-            bmLevel_dB = _bmLevel_dB;
-            bmLevel_lin.setTargetValue(Decibels::decibelsToGain(bmLevel_dB));
-        }
-        bmOperation = static_cast<BitModulation::Operation>(_bmOperation);
-        bitModOpFunc = BitModulation::getOpFunc(bmOperation);
-        bmOperands = static_cast<BitModOperands>(_bmOperands);
+        setBmLevel(Decibels::decibelsToGain(_bmLevel_dB));
+        setBmOperation(_bmOperation);
+        setBmOperands(_bmOperands);
     }
 
     // Tap Tempo
@@ -106,88 +148,280 @@ public:
     void setReferencePotPosition(float referencePosition) { ReferencePotPosition = referencePosition; }
     void setTapTempoEnabled(bool enabled) { TapTempoEnabled = enabled; }
 
+    // how often the filter coefficients and the LFO rate follow their smoothed parameters, in samples
+    void setControlInterval(int numSamples) { parameters.setControlInterval(numSamples); }
+
+    // the tanh of the TAPE soft clipper, see FastTanh for the error of each approximation
+    void setSoftClipperApproximation(FastTanh::Approximation approximation) { softClipperApproximation = approximation; }
+
+    // the interpolation of the modulated delay line reads
+    void setDelayInterpolation(CircularBuffer::Interpolation interpolation) { delayInterpolation = interpolation; }
+
+    // how the delay lines store their history, BFLOAT16 halves their memory. Takes effect at the next prepareToPlay().
+    void setDelayStorage(CircularBuffer::Storage storage) { delayStorage = storage; }
+
+    // Locks the memory the processing uses into RAM, from the next prepareToPlay() on. See DspArena.
+    void setLockMemory(bool shouldLock) { shouldLockMemory = shouldLock; }
+
+    // The memory allocated for the processing, in bytes: the arena of prepareToPlay(), the delay lines grown since and
+    // the tail kept by releaseResources(). Call it from the audio thread, or while it doesn't run.
+    size_t getMemorySize() const { return arena.getSize() + delayLine.getGrownMemorySize() + tailSnapshot.getMemorySize(); }
+    bool isMemoryLocked() const { return arena.isLocked(); }
+
+    // The longest delay time, up to MAX_DELAY_TIME_LIMIT_SEC. Takes effect at the next prepareToPlay(), which only
+    // allocates the delay lines for the current time: they grow in the background when the time goes beyond them.
+    void setMaxDelayTime(float seconds) { maxDelayTime_sec = jlimit(1.0f, MAX_DELAY_TIME_LIMIT_SEC, seconds); }
+
+    // Silence. Once the input, the output and everything written into the delay lines have stayed below
+    // SILENCE_THRESHOLD for a whole delay line, nothing left can come out of it: processBlock goes idle and only
+    // clears the output until the input comes back. The noise, when it is on, keeps it from going idle.
+    static constexpr float SILENCE_THRESHOLD = 1.0e-5f;
+
+    // offline, a longer time doesn't wait for the delay lines to grow in the background
+    void setNonRealtime(bool isNonRealtime) { delayLine.setRealtime(! isNonRealtime); }
+
+    // the input of the coming blocks is known to be silent (the host's silence flags), so it isn't measured
+    void setInputIsSilent(bool isSilent) { inputIsKnownSilent = isSilent; }
+
+    // how many of the last samples were idle, i.e. output as zeros without processing
+    int64 getNumIdleSamples() const { return numIdleSamples; }
+
+    // How long the output takes to fall below SILENCE_THRESHOLD once the input stops, from the loop gain at the
+    // parameters' targets. Infinite when the loop doesn't decay or the noise is on. May be called from any thread.
+    double getTailLengthSeconds() const { return tailLength_sec.load(std::memory_order_relaxed); }
+
 private:
     float fs = 44100.0f;
 
-    static constexpr float MIN_DELAY_SMPLS = 2.0f;
+    // The scratch and parameter lanes and the initial delay lines, allocated by prepareToPlay().
+    // It goes before everything that points into it, so that it is destroyed last.
+    DspArena arena;
+    bool isPrepared = false;
+
+    // processBlock works in sub-blocks of at most this many samples. The delay never gets shorter than a sub-block,
+    // so everything read from the delay lines within a sub-block was written before it started.
+    static constexpr int MAX_SUB_BLOCK_SIZE = 256;
+    static constexpr float MIN_DELAY_SMPLS = MAX_SUB_BLOCK_SIZE + (float) CircularBuffer::MAX_TAPS_AHEAD;
     static constexpr float MAX_MOD_DEPTH_SECS = 0.02f;
+
+    // the delay lines are at least this long from prepareToPlay() on, only longer times wait for them to grow
+    static constexpr float MIN_DELAY_LINE_SEC = 0.5f;
     static constexpr float TAPE_DEL_LOOP_GAIN = 3.98f;
 
-    EffectsRouting effectsRouting = EffectsRouting::OUT;
+    // small signal gain of the TAPE loop, its band-pass peaks at 0.33 around 725 Hz
+    static constexpr float TAPE_LOOP_PEAK_GAIN = TAPE_DEL_LOOP_GAIN * 0.33f;
 
-    // delay
-    SmoothedValM time_smpls = 1.0f;
-    SmoothedValL feedback_lin = 0.0f;
-    ToneType toneType = ToneType::DIGITAL;
+    // how long the DC blocker and the high-passes at their lowest cutoffs take to ring down to the silence threshold
+    static constexpr double FILTER_RING_SEC = 0.1;
 
-    CircularBuffer delayBuffer[NUM_CHANNELS];
-    StaticVASVFilter tapeDelayBandpass[NUM_CHANNELS];
-    StaticVASVFilter delayHiPass[NUM_CHANNELS];
+    // every smoothed parameter lives in the bank, which renders one lane per parameter and sub-block
+    enum SmoothedParameter
+    {
+        TIME_SMPLS,
+        FEEDBACK_LIN,
+        MOD_RATE_HZ,
+        MOD_DEPTH_LIN,
+        MOD_STEREO_PHASE_CYCLES,
+        NOISE_LEVEL_LIN,
+        PHASE_FLIP,
+        BC_DEPTH_LIN,
+        DECIM_REDUCTION_LIN,
+        DECIM_STEREO_SPREAD_LIN,
+        LPF_CUTOFF_HZ,
+        LPF_Q_LIN,
+        HPF_CUTOFF_HZ,
+        HPF_Q_LIN,
+        BM_LEVEL_LIN,
+        NUM_SMOOTHED_PARAMETERS
+    };
+
+    using Smoothing = ParameterBank<NUM_SMOOTHED_PARAMETERS>::Smoothing;
+    ParameterBank<NUM_SMOOTHED_PARAMETERS> parameters;
+
+    // delay
+    StereoDelayLine delayLine;
+    void updateTime();
+    StereoVASVFilter tapeDelayBandpass;
+    StereoVASVFilter delayHiPass;
 
     // modulation
     float maxModDepth_smpls = MAX_MOD_DEPTH_SECS * 44100.0f;
-    SmoothedValM modRate_Hz = MIN_MOD_RATE_HZ;
-    SmoothedValL modDepth_lin = 0.0f;
     FastMathLFO::LFOWave modWave = FastMathLFO::LFOWave::TRI;
 
-    FastMathLFO modLfo[NUM_CHANNELS];
+    // one LFO for both channels, the right one reads it with the stereo phase offset
+    FastMathLFO modLfo;
 
     // noise
-    SmoothedValM noiseLevel_lin = 0.001f;
-    float noiseLevel_dB = MIN_GAIN_DB;
-    NoiseType noiseType = NoiseType::WHITE;
-
     WhiteNoiseGenerator whiteNoiseGen;
     BrownianNoiseGenerator brownianNoiseGen;
+    PinkNoiseGenerator pinkNoiseGen;
 
-    // phase
-    SmoothedValL smoothedPhaseFlip = 1.0f;
+    // decimator
+    StereoDecimator decimator;
 
-    // bit crusher
-    SmoothedValL bcDepth_lin = 0.0f;
+    // low pass and high pass filters
+    StereoVASVFilter lpf;
+    StereoVASVFilter hpf;
 
-    // decimator
-    SmoothedValM decimReduction_lin = 1.0f;
-    SmoothedValL decimStereoSpread_lin = 0.0f;
-    float decimPhasor[NUM_CHANNELS] { 0.0f, 0.0f };
-    float decimCurrentOutput[NUM_CHANNELS] { 0.0f, 0.0f };
-
-    // low pass filter
-    SmoothedValM lpfCutoff_Hz = MAX_FILTER_CUTOFF_FREQ;
-    SmoothedValL lpfQ_lin = MIN_FILTER_Q;
-    FilterPosition lpfPosition = FilterPosition::PRE_BITMOD;
-    StaticVASVFilter lpf[NUM_CHANNELS];
+    StereoDCBlocker dcBlocker;
 
-    // high pass filter
-    SmoothedValM hpfCutoff_Hz = MIN_FILTER_CUTOFF_FREQ;
-    SmoothedValL hpfQ_lin = MIN_FILTER_Q;
-    FilterPosition hpfPosition = FilterPosition::PRE_BITMOD;
-    StaticVASVFilter hpf[NUM_CHANNELS];
+    // Each stage leaves the chain while neutral, i.e. static at the parameter values where it passes its input.
+    // The delay lines are high-passed, only the bit crusher and the bit modulation can leave a DC for the blocker.
+    StageBypass decimatorBypass;
+    StageBypass lpfBypass;
+    StageBypass hpfBypass;
+    StageBypass dcBlockerBypass;
+
+    bool isBitCrusherNeutral() const
+    {
+        return ! parameters.wasMoving(BC_DEPTH_LIN) && parameters.getTargetValue(BC_DEPTH_LIN) <= MIN_BITCRUSHER_Q;
+    }
+
+    bool isDecimatorNeutral() const
+    {
+        return ! parameters.wasMoving(DECIM_REDUCTION_LIN) && parameters.getTargetValue(DECIM_REDUCTION_LIN) >= MAX_DECIMATOR_RATIO;
+    }
+
+    bool isLowPassNeutral() const
+    {
+        return ! parameters.wasMoving(LPF_CUTOFF_HZ) && ! parameters.wasMoving(LPF_Q_LIN)
+            && parameters.getTargetValue(LPF_CUTOFF_HZ) >= MAX_FILTER_CUTOFF_FREQ && parameters.getTargetValue(LPF_Q_LIN) <= MIN_FILTER_Q;
+    }
+
+    bool isHighPassNeutral() const
+    {
+        return ! parameters.wasMoving(HPF_CUTOFF_HZ) && ! parameters.wasMoving(HPF_Q_LIN)
+            && parameters.getTargetValue(HPF_CUTOFF_HZ) <= MIN_FILTER_CUTOFF_FREQ && parameters.getTargetValue(HPF_Q_LIN) <= MIN_FILTER_Q;
+    }
+
+    // silence
+    bool inputIsKnownSilent = false;
+    bool isIdle = false;
+    int numSilentSamples = 0;
+    int64 numIdleSamples = 0;
+
+    bool isNoiseAudible() const
+    {
+        return parameters.wasMoving(NOISE_LEVEL_LIN) || parameters.getTargetValue(NOISE_LEVEL_LIN) > 0.001f;
+    }
+
+    static bool isSilent(const float* const* x, int numChannels, int numSamples);
+    void updateSilence(bool inputIsSilent, const float* const* x, int numChannels, int numSamples);
+    void updateTailLength();
+
+    // scratch memory, in the arena
+    enum ChannelLane
+    {
+        MOD_LANE,       // modulation of the delay time, in samples
+        NOISE_LANE,
+        LINE_LANE,      // delay line output, processed in place by the tone stage
+        FX_LANE,        // effects output
+        WRITE_LANE,     // what goes back into the delay line
+        BITMOD_LANE,    // level scaled bit modulation operand
+        BYPASS_LANE,    // input of a stage whose bypass is fading
+        NUM_CHANNEL_LANES
+    };
 
-    // bit modulation
-    SmoothedValM bmLevel_lin = 0.01f;
-    float bmLevel_dB = MIN_GAIN_DB;
+    float* scratch[NUM_CHANNELS * NUM_CHANNEL_LANES] {};
+    float* parameterLanes[NUM_SMOOTHED_PARAMETERS] {};
+    int subBlockSize = MAX_SUB_BLOCK_SIZE;
+
+    const float* getLane(SmoothedParameter parameter) const { return parameters.getLane(parameter); }
+    float* getLane(ChannelLane lane, int channel)
+    {
+        return scratch[channel * NUM_CHANNEL_LANES + lane];
+    }
+
+    // static at value for the whole sub-block
+    bool isStaticAt(SmoothedParameter parameter, float value) const
+    {
+        return ! parameters.wasMoving(parameter) && parameters.getTargetValue(parameter) == value;
+    }
+
+    // processing stages, each one runs over a whole sub-block.
+    // Channel arrays always hold NUM_CHANNELS pointers, the stateful stages process both channels together.
+    template <NoiseType noise>
+    void renderNoise(int numSamples);
+    void renderModulation(int numSamples);
+    void readDelayLine(int channel, int numSamples);
+    template <ToneType tone>
+    void applyTone(float* const* x, int numSamples);
+    void writeDelayLines(const float* const* dry, float* const* x, int numSamples);
+
+    template <FilterPosition lpfPos, FilterPosition hpfPos, BitModulation::Operation bmOp, BitModOperands operands>
+    void applyEffects(const float* const* dry, const float* const* wet, float* const* y, int numSamples);
+    void applyBitCrusher(float* y, int numSamples);
+    void applyLowPass(float* const* y, int numSamples);
+    void applyHighPass(float* const* y, int numSamples);
+    template <typename Process, typename Reset>
+    void applyStage(StageBypass& bypass, bool isNeutral, float* const* y, int numSamples, Process&& process, Reset&& reset);
+    template <BitModulation::Operation bmOp, BitModOperands operands>
+    void applyBitMod(const float* dry, const float* wet, float* y, int channel, int numSamples);
+
+    // The whole pipeline for one sub-block, writing the first numChannels outputs back into x
+    template <EffectsRouting routing, ToneType tone, NoiseType noise>
+    void processSubBlock(float* const* x, int numChannels, int numSamples);
+
+    // Every combination of the enum parameters gets its own kernel instance, so none of them is tested while
+    // processing. updateKernels() picks the instances whenever a parameter setter runs, i.e. between blocks.
+    using SubBlockKernel = void (DelayProcessor::*)(float* const*, int, int);
+    using EffectsKernel = void (DelayProcessor::*)(const float* const*, const float* const*, float* const*, int);
+
+    static constexpr size_t NUM_SUB_BLOCK_KERNELS = 2 * 2 * 3;      // routing, tone, noise
+    static constexpr size_t NUM_EFFECTS_KERNELS = 2 * 2 * 4 * 3;    // lpf position, hpf position, bitmod operation, operands
+
+    static const std::array<SubBlockKernel, NUM_SUB_BLOCK_KERNELS> subBlockKernels;
+    static const std::array<EffectsKernel, NUM_EFFECTS_KERNELS> effectsKernels;
+
+    template <size_t... Index>
+    static constexpr std::array<SubBlockKernel, sizeof...(Index)> makeSubBlockKernels(std::index_sequence<Index...>);
+    template <size_t... Index>
+    static constexpr std::array<EffectsKernel, sizeof...(Index)> makeEffectsKernels(std::index_sequence<Index...>);
+
+    SubBlockKernel subBlockKernel = nullptr;
+    EffectsKernel effectsKernel = nullptr;
+
+    void updateKernels();
+
+    // Configuration, only read between blocks: the setters pick the kernels from it and set the parameter targets.
+    // It stays out of the cache lines of the processing state above.
+    EffectsRouting effectsRouting = EffectsRouting::OUT;
+    ToneType toneType = ToneType::DIGITAL;
+    NoiseType noiseType = NoiseType::WHITE;
+    FilterPosition lpfPosition = FilterPosition::PRE_BITMOD;
+    FilterPosition hpfPosition = FilterPosition::PRE_BITMOD;
     BitModulation::Operation bmOperation = BitModulation::Operation::NONE;
     BitModOperands bmOperands = BitModOperands::POST_FX_POST_FX;
 
-    BitModulation::OperationFunc bitModOpFunc = BitModulation::getOpFunc(BitModulation::Operation::NONE);
-    DCBlocker dcBlocker[NUM_CHANNELS];
+    FastTanh::Approximation softClipperApproximation = FastTanh::PADE;
+    CircularBuffer::Interpolation delayInterpolation = CircularBuffer::CUBIC;
+    CircularBuffer::Storage delayStorage = CircularBuffer::FLOAT;
+
+    float maxDelayTime_sec = (float) MAX_DELAY_TIME_SEC;
+
+    // the time asked for, TIME_SMPLS stays within what the delay lines hold until they have grown
+    float requestedTime_smpls = MIN_DELAY_SMPLS;
 
     // Tap Tempo
     bool TapTempoEnabled = false;
     float BaseDelayTime_ms = 500.0f;
     float ReferencePotPosition = 0.25f;
 
-    inline float applyBitCrusher(float x, float depth);
-    inline float applyBitMod(float dry, float wet, float wetWithFx, float level);
-    inline float applyDecimator(float x, float reduction, float stereoSpread, int channel);
-    
-    inline float applyEffects(float xDry, float xWet, float phaseFlipSmoothed, float bcDepth, float decimReduction, float decimStereoSpread, float bmLevel, int channel);
-    
-    inline float softClipper(float x)
-    {
-        return std::tanh(x);
-    }
-    
+    bool shouldLockMemory = false;
+
+    // what the arena was allocated for, besides the sample rate, the block size and the delay storage
+    float preparedMaxDelayTime_sec = 0.0f;
+    bool preparedWithLock = false;
+
+    // lays the arena out and sets everything that lives in it up
+    void allocate(float initialDelay_smpls);
+
+    // the tail kept by releaseResources(), and the sample rate it was taken at
+    StereoDelayLine::Snapshot tailSnapshot;
+    float tailSnapshotSampleRate = 0.0f;
+
+    // written by the audio thread, read by the host's
+    CacheLinePadded<std::atomic<double>> tailLength_sec { 0.0 };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayProcessor)
 };
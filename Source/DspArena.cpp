@@ -0,0 +1,58 @@
+#include "DspArena.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+#endif
+
+namespace
+{
+    bool lockMemory(void* data, size_t size)
+    {
+       #if JUCE_WINDOWS
+        return VirtualLock(data, size) != 0;
+       #else
+        return mlock(data, size) == 0;
+       #endif
+    }
+
+    void unlockMemory(void* data, size_t size)
+    {
+       #if JUCE_WINDOWS
+        VirtualUnlock(data, size);
+       #else
+        munlock(data, size);
+       #endif
+    }
+}
+
+void DspArena::allocate(const Layout& layout, bool shouldLock)
+{
+    release();
+
+    size = layout.getSize();
+
+    if (size == 0)
+        return;
+
+    memory.malloc(size + ALIGNMENT - 1);
+    data = reinterpret_cast<char*>((reinterpret_cast<pointer_sized_uint>(memory.get()) + ALIGNMENT - 1) & ~(pointer_sized_uint) (ALIGNMENT - 1));
+
+    // writes every page
+    zeromem(data, size);
+
+    if (shouldLock)
+        locked = lockMemory(data, size);
+}
+
+void DspArena::release()
+{
+    if (locked)
+        unlockMemory(data, size);
+
+    memory.free();
+    data = nullptr;
+    size = 0;
+    locked = false;
+}
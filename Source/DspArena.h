@@ -0,0 +1,68 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+using namespace juce;
+
+// One allocation for the memory an instance plays with. It is cleared when it gets allocated, which touches every
+// page on the preparing thread: the audio thread never takes the page fault of a first touch, an xrun on a real-time
+// kernel. It can be locked into RAM as well. Every block starts on its own cache line.
+class DspArena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    // where the blocks go, to be added before allocate()
+    class Layout
+    {
+    public:
+        // returns the offset of a block of count elements
+        template <typename Type>
+        size_t add(size_t count)
+        {
+            const auto offset = size;
+            size += (count * sizeof(Type) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            return offset;
+        }
+
+        size_t getSize() const { return size; }
+
+    private:
+        size_t size = 0;
+    };
+
+    DspArena() {}
+    ~DspArena() { release(); }
+
+    // Replaces the memory with layout.getSize() cleared bytes, locked into RAM if shouldLock and the system allows it
+    void allocate(const Layout& layout, bool shouldLock);
+    void release();
+
+    template <typename Type>
+    Type* get(size_t offset) const
+    {
+        jassert(offset < size);
+        return reinterpret_cast<Type*>(data + offset);
+    }
+
+    size_t getSize() const { return size; }
+
+    // locking fails beyond the process' limit (RLIMIT_MEMLOCK on Linux)
+    bool isLocked() const { return locked; }
+
+    void swap(DspArena& other) noexcept
+    {
+        std::swap(memory, other.memory);
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(locked, other.locked);
+    }
+
+private:
+    HeapBlock<char> memory;
+    char* data = nullptr;
+    size_t size = 0;
+    bool locked = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DspArena)
+};
@@ -0,0 +1,13 @@
+#include "FastTanh.h"
+
+const FastTanhTable& FastTanhTable::getInstance()
+{
+    static const FastTanhTable table;
+    return table;
+}
+
+FastTanhTable::FastTanhTable()
+{
+    for (int i = 0; i <= TABLE_SIZE; ++i)
+        values[i] = (float) std::tanh(-TABLE_RANGE + 2.0 * TABLE_RANGE * i / TABLE_SIZE);
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include "ProcessorUtils.h"
+
+using namespace juce;
+
+// tanh(x) sampled over [-TABLE_RANGE, TABLE_RANGE] for FastTanh::TABLE, built on first use.
+// Like the filter cutoff table, its users touch it while preparing so that this stays off the audio thread.
+class FastTanhTable
+{
+public:
+    static const FastTanhTable& getInstance();
+
+    inline float lookup(float x) const noexcept
+    {
+        const auto position = (jlimit(-TABLE_RANGE, TABLE_RANGE, x) + TABLE_RANGE) * (TABLE_SIZE / (2.0f * TABLE_RANGE));
+        const auto index = jmin((int) position, TABLE_SIZE - 1);
+        const auto fraction = position - (float) index;
+
+        return values[index] + fraction * (values[index + 1] - values[index]);
+    }
+
+    // The same in every lane: the index math in the register, then a gather of the two neighbours, which only
+    // AVX2 has. The other targets load them lane by lane.
+    inline StereoRegister lookup(StereoRegister x) const noexcept
+    {
+        x = StereoRegister::min(StereoRegister::max(x, StereoRegister::expand(-TABLE_RANGE)), StereoRegister::expand(TABLE_RANGE));
+        const auto position = (x + TABLE_RANGE) * (TABLE_SIZE / (2.0f * TABLE_RANGE));
+        const auto index = StereoRegister::min(StereoRegister::truncate(position), StereoRegister::expand((float) (TABLE_SIZE - 1)));
+        const auto fraction = position - index;
+
+       #if defined (__AVX2__)
+        const auto indices = _mm256_cvttps_epi32(index.value);
+        const auto lower = StereoRegister::fromNative(_mm256_i32gather_ps(values, indices, sizeof(float)));
+        const auto upper = StereoRegister::fromNative(_mm256_i32gather_ps(values + 1, indices, sizeof(float)));
+       #else
+        alignas(sizeof(StereoRegister)) float indices[StereoRegister::size()], lowerValues[StereoRegister::size()], upperValues[StereoRegister::size()];
+        index.copyToRawArray(indices);
+
+        for (size_t lane = 0; lane < StereoRegister::size(); ++lane)
+        {
+            lowerValues[lane] = values[(int) indices[lane]];
+            upperValues[lane] = values[(int) indices[lane] + 1];
+        }
+
+        const auto lower = StereoRegister::fromRawArray(lowerValues);
+        const auto upper = StereoRegister::fromRawArray(upperValues);
+       #endif
+
+        return lower + fraction * (upper - lower);
+    }
+
+private:
+    FastTanhTable();
+
+    // 1 - tanh(8) is about 2e-7
+    static constexpr float TABLE_RANGE = 8.0f;
+    static constexpr int TABLE_SIZE = 1024;
+
+    float values[TABLE_SIZE + 1];
+
+    JUCE_DECLARE_NON_COPYABLE(FastTanhTable)
+};
+
+// Approximations of tanh for the soft clippers. Each one comes as a scalar kernel, a register kernel (every lane of a
+// StereoRegister, not only the stereo pair) and a block kernel. std::tanh has no vector form, EXACT's register kernel
+// runs it lane by lane.
+// The MAX_ERROR constants bound |approximation - std::tanh| over all finite inputs, the bench's --check-tanh
+// measures them. All of them stay within [-1, 1].
+class FastTanh
+{
+public:
+    enum Approximation
+    {
+        EXACT,
+        PADE,
+        POLYNOMIAL,
+        TABLE
+    };
+
+    static constexpr float PADE_MAX_ERROR = 1.0e-4f;
+    static constexpr float POLYNOMIAL_MAX_ERROR = 1.1e-2f;
+    static constexpr float TABLE_MAX_ERROR = 3.0e-5f;
+
+    // [7/6] Pade approximant, as juce::dsp::FastMathApproximations::tanh. It reaches 1 at PADE_LIMIT, where it is
+    // clamped, the largest error being that of the clamp.
+    static inline float pade(float x) noexcept
+    {
+        x = jlimit(-PADE_LIMIT, PADE_LIMIT, x);
+        const auto x2 = x * x;
+        const auto numerator = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)));
+        const auto denominator = 135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f));
+        return numerator / denominator;
+    }
+
+    // Odd polynomial of degree 9, fitted to tanh over [0, POLYNOMIAL_LIMIT] with p(limit) = 1 and p'(limit) = p''(limit) = 0,
+    // so it rises monotonically into the clamp without a kink. No division, it is the cheapest one on the stereo registers.
+    static inline float polynomial(float x) noexcept
+    {
+        x = jlimit(-POLYNOMIAL_LIMIT, POLYNOMIAL_LIMIT, x);
+        const auto x2 = x * x;
+        return x * (P1 + x2 * (P3 + x2 * (P5 + x2 * (P7 + x2 * P9))));
+    }
+
+    static inline float table(float x) noexcept
+    {
+        return FastTanhTable::getInstance().lookup(x);
+    }
+
+    template <Approximation approximation>
+    static inline float process(float x) noexcept
+    {
+        if (approximation == PADE)
+            return pade(x);
+
+        if (approximation == POLYNOMIAL)
+            return polynomial(x);
+
+        if (approximation == TABLE)
+            return table(x);
+
+        return std::tanh(x);
+    }
+
+    template <Approximation approximation>
+    static inline StereoRegister process(StereoRegister x) noexcept
+    {
+        if (approximation == PADE)
+        {
+            x = StereoRegister::min(StereoRegister::max(x, StereoRegister::expand(-PADE_LIMIT)), StereoRegister::expand(PADE_LIMIT));
+            const auto x2 = x * x;
+            const auto numerator = x * ((((x2 + 378.0f) * x2) + 17325.0f) * x2 + 135135.0f);
+            const auto denominator = (((x2 * 28.0f) + 3150.0f) * x2 + 62370.0f) * x2 + 135135.0f;
+            return divide(numerator, denominator);
+        }
+
+        if (approximation == POLYNOMIAL)
+        {
+            x = StereoRegister::min(StereoRegister::max(x, StereoRegister::expand(-POLYNOMIAL_LIMIT)), StereoRegister::expand(POLYNOMIAL_LIMIT));
+            const auto x2 = x * x;
+            return x * ((((x2 * P9 + P7) * x2 + P5) * x2 + P3) * x2 + P1);
+        }
+
+        if (approximation == TABLE)
+            return FastTanhTable::getInstance().lookup(x);
+
+        alignas(sizeof(StereoRegister)) float values[StereoRegister::size()];
+        x.copyToRawArray(values);
+
+        for (auto& value : values)
+            value = process<approximation>(value);
+
+        return StereoRegister::fromRawArray(values);
+    }
+
+    template <Approximation approximation>
+    static void processBlock(float* x, int numSamples) noexcept
+    {
+        int i = 0;
+
+        // The clamps keep the compiler from vectorising the scalar loop (comparisons may trap), so the Pade and
+        // polynomial kernels go through the registers explicitly. The table only gathers with AVX2, std::tanh stays scalar.
+        if (approximation == PADE || approximation == POLYNOMIAL)
+        {
+            constexpr auto width = (int) StereoRegister::size();
+            alignas(sizeof(StereoRegister)) float values[StereoRegister::size()];
+
+            for (; i + width <= numSamples; i += width)
+            {
+                memcpy(values, x + i, sizeof(values));
+                process<approximation>(StereoRegister::fromRawArray(values)).copyToRawArray(values);
+                memcpy(x + i, values, sizeof(values));
+            }
+        }
+
+        for (; i < numSamples; ++i)
+            x[i] = process<approximation>(x[i]);
+    }
+
+    // run time selection, once per call
+    static float process(Approximation approximation, float x) noexcept
+    {
+        switch (approximation)
+        {
+            case PADE:       return process<PADE>(x);
+            case POLYNOMIAL: return process<POLYNOMIAL>(x);
+            case TABLE:      return process<TABLE>(x);
+            case EXACT:
+            default:         return process<EXACT>(x);
+        }
+    }
+
+    static StereoRegister process(Approximation approximation, StereoRegister x) noexcept
+    {
+        switch (approximation)
+        {
+            case PADE:       return process<PADE>(x);
+            case POLYNOMIAL: return process<POLYNOMIAL>(x);
+            case TABLE:      return process<TABLE>(x);
+            case EXACT:
+            default:         return process<EXACT>(x);
+        }
+    }
+
+    static void processBlock(Approximation approximation, float* x, int numSamples) noexcept
+    {
+        switch (approximation)
+        {
+            case PADE:       processBlock<PADE>(x, numSamples); break;
+            case POLYNOMIAL: processBlock<POLYNOMIAL>(x, numSamples); break;
+            case TABLE:      processBlock<TABLE>(x, numSamples); break;
+            case EXACT:
+            default:         processBlock<EXACT>(x, numSamples); break;
+        }
+    }
+
+private:
+    static constexpr float PADE_LIMIT = 4.97f;
+    static constexpr float POLYNOMIAL_LIMIT = 3.0f;
+
+    // P1 is rounded down a little, p(limit) would come out just above 1 otherwise
+    static constexpr float P1 = 0.9579371f;
+    static constexpr float P3 = -0.222148013f;
+    static constexpr float P5 = 0.0354984298f;
+    static constexpr float P7 = -0.00285939410f;
+    static constexpr float P9 = 0.0000889885204f;
+};
@@ -1,25 +1,111 @@
 #include "NoiseGenerator.h"
 
-void BrownianNoiseGenerator::generateNormalisedSamples()
+BrownianNoiseTables::BrownianNoiseTables()
 {
-    std::vector<float> unnormalisedSamples(NUM_BUFFERED_SAMPLES);
-    unnormalisedSamples[0] = lastUnnormalisedSample + uniformRandomValue();
-    
-    for (int i = 1; i < NUM_BUFFERED_SAMPLES; i++)
+    samples.malloc(NUM_TABLES * TABLE_SIZE);
+
+    BlockRandom random;
+    HeapBlock<float> unnormalised(TABLE_SIZE);
+    float lastUnnormalisedSample = 0.0f;
+
+    for (int index = 0; index < NUM_TABLES; ++index)
     {
-        unnormalisedSamples[i] = 0.95f * unnormalisedSamples[i - 1] + uniformRandomValue(); // leaky integration
+        random.fillUniform(unnormalised, TABLE_SIZE);
+
+        unnormalised[0] += lastUnnormalisedSample;
+
+        for (int i = 1; i < TABLE_SIZE; i++)
+        {
+            unnormalised[i] += 0.95f * unnormalised[i - 1]; // leaky integration
+        }
+
+        const auto range = FloatVectorOperations::findMinAndMax(unnormalised.get(), TABLE_SIZE);
+        const auto minMaxDiff = jmax(range.getLength(), 1.0e-6f);
+
+        // 0.8 * (2 * (x - min) / (max - min) - 1)
+        auto* normalised = samples + index * TABLE_SIZE;
+        const auto scale = 1.6f / minMaxDiff;
+
+        for (int i = 0; i < TABLE_SIZE; i++)
+            normalised[i] = (unnormalised[i] - range.getStart()) * scale - 0.8f;
+
+        lastUnnormalisedSample = unnormalised[TABLE_SIZE - 1];
     }
-    
-    auto maxB = *std::max_element(unnormalisedSamples.begin(), unnormalisedSamples.end());
-    auto minB = *std::min_element(unnormalisedSamples.begin(), unnormalisedSamples.end());
-    
-    // normalisedSamples.clear();
-    auto minMaxDiff = maxB - minB;
-    for (int i = 0; i < NUM_BUFFERED_SAMPLES; i++)
+}
+
+void BrownianNoiseGenerator::reset(float sampleRate)
+{
+    NoiseGenerator::reset(sampleRate);
+
+    pickTables(currentTables);
+
+    // instances reset together don't change tables together
+    float draw;
+    random.fillUniform(&draw, 1);
+    readPosition = jlimit(0, FADE_START - 1, (int) ((draw + 1.0f) * 0.5f * FADE_START));
+}
+
+void BrownianNoiseGenerator::processBlock(float* left, float* right, int numSamples)
+{
+    int done = 0;
+
+    while (done < numSamples)
     {
-        auto unSmpl = unnormalisedSamples[i];
-        normalisedSamples[i] = 0.8f * (2.0f * (unSmpl - minB) / minMaxDiff - 1.0f);
+        if (readPosition < FADE_START)
+        {
+            const int count = jmin(numSamples - done, FADE_START - readPosition);
+
+            FloatVectorOperations::copy(left + done, currentTables[0] + readPosition, count);
+            FloatVectorOperations::copy(right + done, currentTables[1] + readPosition, count);
+
+            done += count;
+            readPosition += count;
+
+            if (readPosition == FADE_START)
+                pickTables(nextTables);
+
+            continue;
+        }
+
+        // the tail of the current tables fades into the head of the next ones, linearly
+        const int count = jmin(numSamples - done, TABLE_SIZE - readPosition);
+        float* dest[] { left + done, right + done };
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            const auto* from = currentTables[channel] + readPosition;
+            const auto* to = nextTables[channel] + readPosition - FADE_START;
+
+            for (int i = 0; i < count; ++i)
+            {
+                const auto fade = (float) (readPosition - FADE_START + i + 1) * (1.0f / (FADE_LENGTH + 1));
+                dest[channel][i] = from[i] + fade * (to[i] - from[i]);
+            }
+        }
+
+        done += count;
+        readPosition += count;
+
+        if (readPosition == TABLE_SIZE)
+        {
+            currentTables[0] = nextTables[0];
+            currentTables[1] = nextTables[1];
+            readPosition = FADE_LENGTH;
+        }
     }
-    lastUnnormalisedSample = unnormalisedSamples.back();
-    currPosition = 0;
+}
+
+void BrownianNoiseGenerator::pickTables(const float** dest)
+{
+    constexpr int numTables = BrownianNoiseTables::NUM_TABLES;
+
+    float draws[2];
+    random.fillUniform(draws, 2);
+
+    // from [-1, 1) to a table, the right channel's skips the left one's
+    const auto leftTable = jlimit(0, numTables - 1, (int) ((draws[0] + 1.0f) * 0.5f * numTables));
+    const auto rightOffset = 1 + jlimit(0, numTables - 2, (int) ((draws[1] + 1.0f) * 0.5f * (numTables - 1)));
+
+    dest[0] = tables->getTable(leftTable);
+    dest[1] = tables->getTable((leftTable + rightOffset) % numTables);
 }
@@ -1,82 +1,210 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+
+#include "ProcessorUtils.h"
+
 using namespace juce;
+
+// xoshiro128+ (Blackman & Vigna), with NUM_STREAMS independent states stepped together so the loop vectorises
+class BlockRandom
+{
+public:
+    BlockRandom() { seed((uint64) Random::getSystemRandom().nextInt64()); }
+
+    void seed(uint64 seedValue)
+    {
+        // splitmix64 spreads the seed over all the state words
+        auto next = [&seedValue]
+        {
+            auto z = (seedValue += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return (uint32) ((z ^ (z >> 31)) >> 32);
+        };
+
+        for (int lane = 0; lane < NUM_STREAMS; ++lane)
+        {
+            s0[lane] = next() | 1u;
+            s1[lane] = next();
+            s2[lane] = next();
+            s3[lane] = next();
+        }
+    }
+
+    // uniform values in [-1, 1)
+    void fillUniform(float* dest, int numSamples) noexcept
+    {
+        int i = 0;
+
+        for (; i + NUM_STREAMS <= numSamples; i += NUM_STREAMS)
+            step(dest + i);
+
+        if (i < numSamples)
+        {
+            float tail[NUM_STREAMS];
+            step(tail);
+
+            for (int lane = 0; lane < numSamples - i; ++lane)
+                dest[i + lane] = tail[lane];
+        }
+    }
+
+private:
+    static constexpr int NUM_STREAMS = 4;
+
+    uint32 s0[NUM_STREAMS], s1[NUM_STREAMS], s2[NUM_STREAMS], s3[NUM_STREAMS];
+
+    inline void step(float* dest) noexcept
+    {
+        for (int lane = 0; lane < NUM_STREAMS; ++lane)
+        {
+            const auto result = s0[lane] + s3[lane];
+            const auto t = s1[lane] << 9;
+
+            s2[lane] ^= s0[lane];
+            s3[lane] ^= s1[lane];
+            s1[lane] ^= s2[lane];
+            s0[lane] ^= s3[lane];
+            s2[lane] ^= t;
+            s3[lane] = (s3[lane] << 11) | (s3[lane] >> 21);
+
+            // the top 24 bits, the low ones of xoshiro128+ are weak
+            dest[lane] = (float) (result >> 8) * (2.0f / 16777216.0f) - 1.0f;
+        }
+    }
+};
+
+// All generators render stereo blocks, the left and right channels being uncorrelated
 class NoiseGenerator
 {
 public:
     NoiseGenerator() {}
     virtual ~NoiseGenerator() {}
-    
-    void reset(float sampleRate)
+
+    virtual void reset(float sampleRate)
     {
         fs = sampleRate;
     }
-    
-    virtual float nextValue() { return 0.0f; };
-    
+
+    virtual void processBlock(float* left, float* right, int numSamples) = 0;
+
 protected:
     float fs = 44100.0f;
-    
-    Random random;
-    
-    inline float uniformRandomValue()
-    {
-        return 2.0f * random.nextFloat() - 1.0f;
-    }
-    
+
+    BlockRandom random;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoiseGenerator)
 };
 
-class WhiteNoiseGenerator : NoiseGenerator
+class WhiteNoiseGenerator : public NoiseGenerator
 {
 public:
     WhiteNoiseGenerator() : NoiseGenerator() {}
-    
-    void reset(float sampleRate)
-    {
-        NoiseGenerator::reset(sampleRate);
-    }
-    
-    float nextValue() override
+
+    void processBlock(float* left, float* right, int numSamples) override
     {
-        return uniformRandomValue();
+        random.fillUniform(left, numSamples);
+        random.fillUniform(right, numSamples);
     }
-    
+
 private:
-    
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WhiteNoiseGenerator)
 };
 
-class BrownianNoiseGenerator : NoiseGenerator
+// Paul Kellett's refined pink noise filter (-3 dB/octave within 0.05 dB above 9 Hz at 44.1 kHz) on white noise.
+// The one poles of both channels are independent of each other and stay in registers, so their chains overlap.
+class PinkNoiseGenerator : public NoiseGenerator
 {
 public:
-    BrownianNoiseGenerator() : NoiseGenerator(), normalisedSamples(NUM_BUFFERED_SAMPLES) {}
-    
-    void reset(float sampleRate)
+    PinkNoiseGenerator() : NoiseGenerator() {}
+
+    void reset(float sampleRate) override
     {
         NoiseGenerator::reset(sampleRate);
-        lastUnnormalisedSample = 0.0f;
-        // currPosition = 0;
-        generateNormalisedSamples();
+        zeromem(state, sizeof(state));
     }
-    
-    float nextValue() override
+
+    void processBlock(float* left, float* right, int numSamples) override
     {
-        if (currPosition == NUM_BUFFERED_SAMPLES)
-            generateNormalisedSamples();
-        
-        return normalisedSamples[currPosition++];
+        random.fillUniform(left, numSamples);
+        random.fillUniform(right, numSamples);
+
+        float b[2][7];
+        memcpy(b, state, sizeof(state));
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            left[i] = processSample(b[0], left[i]);
+            right[i] = processSample(b[1], right[i]);
+        }
+
+        memcpy(state, b, sizeof(state));
     }
-    
+
+private:
+    // b0 to b6 of the original filter, per channel
+    float state[2][7];
+
+    static inline float processSample(float* b, float white) noexcept
+    {
+        b[0] = 0.99886f * b[0] + white * 0.0555179f;
+        b[1] = 0.99332f * b[1] + white * 0.0750759f;
+        b[2] = 0.96900f * b[2] + white * 0.1538520f;
+        b[3] = 0.86650f * b[3] + white * 0.3104856f;
+        b[4] = 0.55000f * b[4] + white * 0.5329522f;
+        b[5] = -0.7616f * b[5] - white * 0.0168980f;
+
+        // the filter has a gain of about 9 for uniform white noise, scaled back to roughly [-1, 1]
+        const auto pink = (b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362f) * 0.11f;
+        b[6] = white * 0.115926f;
+        return pink;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PinkNoiseGenerator)
+};
+
+// NUM_TABLES tables of TABLE_SIZE samples of leaky integrated white noise, each one normalised to [-0.8, 0.8].
+// They don't depend on the sample rate, so one set serves every instance of the process: the first
+// BrownianNoiseGenerator builds it and the last one frees it.
+class BrownianNoiseTables
+{
+public:
+    BrownianNoiseTables();
+
+    static constexpr int TABLE_SIZE = 16384;
+    static constexpr int NUM_TABLES = 16;
+
+    const float* getTable(int index) const noexcept { return samples + index * TABLE_SIZE; }
+
 private:
-    static constexpr int NUM_BUFFERED_SAMPLES = 44100;
-    
-    float lastUnnormalisedSample = 0.0f;
-    std::vector<float> normalisedSamples;
-    int currPosition = 0;
-    
-    void generateNormalisedSamples();
-    
+    HeapBlock<float> samples;
+
+    JUCE_DECLARE_NON_COPYABLE(BrownianNoiseTables)
+};
+
+// Brownian noise from the shared BrownianNoiseTables. Each channel plays a table and fades its last FADE_LENGTH samples
+// into another one picked at random, never the one the other channel goes on with.
+class BrownianNoiseGenerator : public NoiseGenerator
+{
+public:
+    BrownianNoiseGenerator() : NoiseGenerator() {}
+
+    void reset(float sampleRate) override;
+    void processBlock(float* left, float* right, int numSamples) override;
+
+private:
+    static constexpr int TABLE_SIZE = BrownianNoiseTables::TABLE_SIZE;
+    static constexpr int FADE_LENGTH = 256;
+    static constexpr int FADE_START = TABLE_SIZE - FADE_LENGTH;
+
+    SharedResourcePointer<BrownianNoiseTables> tables;
+    const float* currentTables[2] {};
+    const float* nextTables[2] {};
+    int readPosition = 0;
+
+    void pickTables(const float** dest);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BrownianNoiseGenerator)
 };
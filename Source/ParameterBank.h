@@ -0,0 +1,196 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+
+using namespace juce;
+
+// Block rate replacement for a set of SmoothedValues, with the same linear and multiplicative ramps.
+// render() only writes a lane while its parameter is ramping. When a ramp ends the lane is filled with the
+// target once, a static parameter then costs nothing until it gets a new target.
+template <int NumParameters>
+class ParameterBank
+{
+public:
+    static_assert(NumParameters <= 32, "the moving parameters are tracked in a 32 bit mask");
+
+    static constexpr int DEFAULT_CONTROL_INTERVAL = 16;
+
+    enum class Smoothing
+    {
+        LINEAR,
+        MULTIPLICATIVE
+    };
+
+    ParameterBank() {}
+
+    // call before prepare(), the value is taken as both current and target
+    void setSmoothing(int index, Smoothing smoothing, float rampLength_sec, float initialValue)
+    {
+        auto& ramp = ramps[index];
+        ramp.smoothing = smoothing;
+        ramp.length_sec = rampLength_sec;
+
+        current[index] = initialValue;
+        target[index] = initialValue;
+        countdown[index] = 0;
+
+        rampingMask &= ~bit(index);
+        staleLaneMask |= bit(index);
+    }
+
+    // Snaps every parameter to its target. laneMemory holds one lane of maxBlockSize samples per parameter, owned
+    // by the caller.
+    void prepare(double sampleRate, int maxBlockSize, float* const* laneMemory)
+    {
+        maxNumSamples = maxBlockSize;
+
+        for (int index = 0; index < NumParameters; ++index)
+        {
+            lanes[index] = laneMemory[index];
+            ramps[index].length_smpls = (int) std::floor(ramps[index].length_sec * sampleRate);
+            current[index] = target[index];
+            countdown[index] = 0;
+        }
+
+        rampingMask = 0;
+        staleLaneMask = ALL_PARAMETERS;
+        movingMask = 0;
+    }
+
+    void setTargetValue(int index, float newValue) noexcept
+    {
+        if (newValue == target[index])
+            return;
+
+        const auto& ramp = ramps[index];
+
+        target[index] = newValue;
+        staleLaneMask |= bit(index);
+
+        if (ramp.length_smpls <= 0)
+        {
+            current[index] = newValue;
+            countdown[index] = 0;
+            rampingMask &= ~bit(index);
+            return;
+        }
+
+        countdown[index] = ramp.length_smpls;
+        rampingMask |= bit(index);
+
+        if (ramp.smoothing == Smoothing::LINEAR)
+        {
+            step[index] = (target[index] - current[index]) / (float) countdown[index];
+        }
+        else
+        {
+            jassert(current[index] > 0.0f && target[index] > 0.0f);
+            step[index] = std::exp((std::log(target[index]) - std::log(current[index])) / (float) countdown[index]);
+        }
+    }
+
+    float getTargetValue(int index) const noexcept { return target[index]; }
+    float getCurrentValue(int index) const noexcept { return current[index]; }
+    bool isSmoothing(int index) const noexcept { return (rampingMask & bit(index)) != 0; }
+
+    // Advances all parameters by numSamples and updates the lanes of the ones that moved. Only the parameters whose
+    // bits are set in the masks get touched.
+    void render(int numSamples) noexcept
+    {
+        jassert(numSamples <= maxNumSamples);
+
+        movingMask = rampingMask;
+
+        // the lanes of the parameters that stopped, filled with their target once
+        auto stopped = staleLaneMask & ~rampingMask;
+
+        for (int index = 0; stopped != 0; ++index, stopped >>= 1)
+            if ((stopped & 1) != 0)
+                FloatVectorOperations::fill(lanes[index], target[index], maxNumSamples);
+
+        staleLaneMask &= rampingMask;
+
+        auto ramping = rampingMask;
+
+        for (int index = 0; ramping != 0; ++index, ramping >>= 1)
+        {
+            if ((ramping & 1) == 0)
+                continue;
+
+            auto* lane = lanes[index];
+            const int rampSamples = jmin(numSamples, countdown[index]);
+
+            if (ramps[index].smoothing == Smoothing::LINEAR)
+            {
+                for (int i = 0; i < rampSamples; ++i)
+                    lane[i] = current[index] + step[index] * (float) (i + 1);
+            }
+            else
+            {
+                auto value = current[index];
+
+                for (int i = 0; i < rampSamples; ++i)
+                {
+                    value *= step[index];
+                    lane[i] = value;
+                }
+            }
+
+            countdown[index] -= rampSamples;
+
+            if (countdown[index] > 0)
+            {
+                current[index] = lane[rampSamples - 1];
+                continue;
+            }
+
+            // the ramp ended within this block, the next render() refills the whole lane
+            current[index] = target[index];
+            FloatVectorOperations::fill(lane + rampSamples, target[index], numSamples - rampSamples);
+            rampingMask &= ~bit(index);
+        }
+    }
+
+    // valid for the numSamples of the last render()
+    const float* getLane(int index) const noexcept { return lanes[index]; }
+
+    // whether the parameter was ramping during the last render()
+    bool wasMoving(int index) const noexcept { return (movingMask & (1u << index)) != 0; }
+
+    // Values that are expensive to derive from the parameters (filter coefficients, LFO increments)
+    // are only refreshed every controlInterval samples while their parameters move.
+    void setControlInterval(int numSamples) noexcept { controlInterval = jmax(1, numSamples); }
+    int getControlInterval() const noexcept { return controlInterval; }
+
+private:
+    static constexpr uint32 ALL_PARAMETERS = NumParameters == 32 ? ~0u : (1u << NumParameters) - 1;
+    static constexpr size_t NUM_PARAMETERS = (size_t) NumParameters;
+
+    static constexpr uint32 bit(int index) noexcept { return 1u << index; }
+
+    // The state of the ramps, one array per field: render() only reads what it needs of the parameters that move.
+    float current[NUM_PARAMETERS] {};
+    float target[NUM_PARAMETERS] {};
+    float step[NUM_PARAMETERS] {};
+    int countdown[NUM_PARAMETERS] {};
+    float* lanes[NUM_PARAMETERS] {};
+
+    uint32 rampingMask = 0;         // countdown > 0
+    uint32 staleLaneMask = 0;       // the lane doesn't hold the target across maxNumSamples yet
+    uint32 movingMask = 0;
+    int maxNumSamples = 0;
+    int controlInterval = DEFAULT_CONTROL_INTERVAL;
+
+    // how each parameter ramps, only read when it gets a new target
+    struct Ramp
+    {
+        Smoothing smoothing = Smoothing::LINEAR;
+        float length_sec = 0.0f;
+        int length_smpls = 0;
+    };
+
+    Ramp ramps[NUM_PARAMETERS];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterBank)
+};
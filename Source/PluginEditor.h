@@ -21,18 +21,22 @@ private:
             : time(state.time),
               feedback(state.feedback),
               beatMultiply(state.beatMultiply),
+              maxTime(state.maxTime),
               toneType(state.toneType),
               effectsRouting(state.effectsRouting)
         {
-            addAllAndMakeVisible(*this, time, feedback, beatMultiply, toneType, effectsRouting);
+            addAllAndMakeVisible(*this, time, feedback, beatMultiply, maxTime, toneType, effectsRouting);
+
+            // the time's text depends on the Max Time it's stretched to
+            maxTime.getSlider().onValueChange = [this] { time.getSlider().updateText(); };
         }
 
         void resized() override
         {
-            performLayout(getLocalBounds(), time, feedback, beatMultiply, toneType, effectsRouting);
+            performLayout(getLocalBounds(), time, feedback, beatMultiply, maxTime, toneType, effectsRouting);
         }
 
-        AttachedSlider time, feedback, beatMultiply;
+        AttachedSlider time, feedback, beatMultiply, maxTime;
         AttachedCombo toneType, effectsRouting;
     };
 
@@ -41,19 +45,20 @@ private:
         explicit ModAndNoiseControls(const StrangeReturnsAudioProcessor::ParameterReferences& state)
             : modRate(state.modRate),
               modDepth(state.modDepth),
+              modStereoPhase(state.modStereoPhase),
               noiseLevel(state.noiseLevel),
               modWave(state.modWave),
               noiseType(state.noiseType)
         {
-            addAllAndMakeVisible(*this, modRate, modDepth, modWave, noiseLevel, noiseType);
+            addAllAndMakeVisible(*this, modRate, modDepth, modStereoPhase, modWave, noiseLevel, noiseType);
         }
 
         void resized() override
         {
-            performLayout(getLocalBounds(), modRate, modDepth, modWave, noiseLevel, noiseType);
+            performLayout(getLocalBounds(), modRate, modDepth, modStereoPhase, modWave, noiseLevel, noiseType);
         }
 
-        AttachedSlider modRate, modDepth, noiseLevel;
+        AttachedSlider modRate, modDepth, modStereoPhase, noiseLevel;
         AttachedCombo modWave, noiseType;
     };
 
@@ -15,13 +15,27 @@ StrangeReturnsAudioProcessor::StrangeReturnsAudioProcessor(AudioProcessorValueTr
     parameters { layout },
     vts(*this, nullptr, Identifier("Parameters"), std::move(layout))
 {
-    vts.state.addListener(this);
-    vts.addParameterListener(paramID::tapTempoButton, this);
+    jassert(getParameters().size() <= MAX_NUM_PARAMETERS);
+
+    // as far as the Max Time setting goes, the delay lines only grow that long when the time gets there
+    delayProcessor.setMaxDelayTime(MAX_DELAY_TIME_LIMIT_SEC);
+
+    // every parameter starts out dirty, with its current value in the snapshot
+    for (auto* parameter : getParameters())
+    {
+        parameterValueChanged(parameter->getParameterIndex(), parameter->getValue());
+        parameter->addListener(this);
+    }
+
+    startTimerHz(TAP_TEMPO_TIMER_HZ);
 }
 
 StrangeReturnsAudioProcessor::~StrangeReturnsAudioProcessor()
 {
-    vts.removeParameterListener(paramID::tapTempoButton, this);
+    stopTimer();
+
+    for (auto* parameter : getParameters())
+        parameter->removeListener(this);
 }
 
 //==============================================================================
@@ -61,12 +75,13 @@ bool StrangeReturnsAudioProcessor::isMidiEffect() const
 void StrangeReturnsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     delayProcessor.prepareToPlay(sampleRate, samplesPerBlock);
+    tapTempo.prepare(sampleRate);
 }
 
 void StrangeReturnsAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    // the echoes still ringing come back with the next prepareToPlay(), the delay lines don't stay allocated meanwhile
+    delayProcessor.releaseResources(true);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -104,73 +119,225 @@ void StrangeReturnsAudioProcessor::processBlock (AudioBuffer<float>& buffer, Mid
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    if (requiresUpdate.load())
+    const auto allDirty = dirtyParameters.exchange(0, std::memory_order_acquire);
+    const auto dirty = allDirty & ~changingParameters;
+
+    if (dirty != 0)
+    {
+        loadParameterSnapshot(dirty);
+        applyParameterChanges(dirty);
+    }
+
+    queueTapButtonPresses(dirty);
+
+    // whatever the taps change is applied with the next block
+    processTapTempo(buffer.getNumSamples());
+
+    auto allChannels = [](int numChannels) { return numChannels > 0 ? ((uint64) 1 << numChannels) - 1 : (uint64) 0; };
+
+    const auto inputChannels = allChannels(totalNumInputChannels);
+    delayProcessor.setNonRealtime(isNonRealtime());
+    delayProcessor.setInputIsSilent(inputChannels != 0 && (inputSilenceFlags & inputChannels) == inputChannels);
+    inputSilenceFlags = 0;
+
+    if (numParameterChanges > 0)
+        processBlockBetweenChanges(buffer);
+    else
+        delayProcessor.processBlock(buffer);
+
+    const auto deferred = allDirty & changingParameters;
+
+    if (deferred != 0)
     {
-        auto timePot_ms = parameters.time.get();
-        auto feedback = parameters.feedback.get();
-        auto toneType = parameters.toneType.getIndex();
+        loadParameterSnapshot(deferred);
+        applyParameterChanges(deferred);
+    }
+
+    clearParameterChanges();
+
+    outputSilenceFlags = delayProcessor.getNumIdleSamples() >= buffer.getNumSamples() ? allChannels(totalNumOutputChannels) : 0;
+}
 
-        auto modRate = parameters.modRate.get();
-        auto modDepth = parameters.modDepth.get();
-        auto modWave = parameters.modWave.getIndex();
+void StrangeReturnsAudioProcessor::processBlockBypassed (AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    // the parameters are applied from their snapshot once processBlock() runs again, the taps are ignored
+    clearParameterChanges();
+    tapButtonFifo.finishedRead(tapButtonFifo.getNumReady());
+    numTapButtonPressesQueued = numTapButtonPresses.load(std::memory_order_relaxed);
+
+    AudioProcessor::processBlockBypassed(buffer, midiMessages);
+}
 
-        auto noiseLevel = parameters.noiseLevel.get();
-        auto noiseType = parameters.noiseType.getIndex();
+void StrangeReturnsAudioProcessor::processBlockBetweenChanges(AudioBuffer<float>& buffer)
+{
+    const int numSamples = buffer.getNumSamples();
 
-        float currentBeatMultiplyFactor = parameters.beatMultiply.getCurrentChoiceName().getFloatValue();
+    auto getOffset = [this, numSamples](int change) { return jlimit(0, numSamples, parameterChanges[(size_t) change].sampleOffset); };
+
+    int start = 0;
+    int change = 0;
+
+    while (change < numParameterChanges)
+    {
+        const int offset = getOffset(change);
 
-        float effectiveTime = (parameters.tapTempoEnabled.get()
-                                   ? jmax(50.0f, currentBeatMultiplyFactor * TapTempoTime_ms + (timePot_ms - TimeAtTapTempoActivation))
-                                   : timePot_ms * currentBeatMultiplyFactor);
+        if (offset > start)
+        {
+            delayProcessor.processBlock(buffer, start, offset - start);
+            start = offset;
+        }
 
-        DBG("delta time: " + String(timePot_ms - TimeAtTapTempoActivation));
+        uint64 changed = 0;
 
-        delayProcessor.setDelayParameters(effectiveTime, feedback, toneType, modRate, modDepth, modWave, noiseLevel, noiseType);
+        for (; change < numParameterChanges && getOffset(change) == offset; ++change)
+        {
+            const auto& parameterChange = parameterChanges[(size_t) change];
+            const auto bit = (uint64) 1 << parameterChange.parameterIndex;
 
-        auto effectsRouting = parameters.effectsRouting.getIndex();
+            // dropped when the queue overflowed, its last value was applied at the start instead
+            if ((changingParameters & bit) == 0)
+                continue;
 
-        auto flipPhase = parameters.flipPhase.get();
+            appliedValues[(size_t) parameterChange.parameterIndex] = parameterChange.value;
+            changed |= bit;
+        }
 
-        auto bcDepth = parameters.bcDepth.get();
+        applyParameterChanges(changed);
+    }
 
-        auto decimReduction = parameters.decimReduction.get();
-        auto decimStereoSpread = parameters.decimStereoSpread.get();
+    if (start < numSamples)
+        delayProcessor.processBlock(buffer, start, numSamples - start);
+}
 
-        auto lpfCutoff = parameters.lpfCutoff.get();
-        auto lpfQ = parameters.lpfQ.get();
-        auto lpfPosition = parameters.lpfPosition.getIndex();
+void StrangeReturnsAudioProcessor::beginParameterChangePoints()
+{
+    clearParameterChanges();
 
-        auto hpfCutoff = parameters.hpfCutoff.get();
-        auto hpfQ = parameters.hpfQ.get();
-        auto hpfPosition = parameters.hpfPosition.getIndex();
+    // The button's points are timed for a block that never came. The editor's presses are only queued by
+    // processBlock(), those still count.
+    tapButtonFifo.finishedRead(tapButtonFifo.getNumReady());
+}
 
-        auto bmLevel = parameters.bmLevel.get();
-        auto bmOperation = parameters.bmOperation.getIndex();
-        auto bmOperands = parameters.bmOperands.getIndex();
+void StrangeReturnsAudioProcessor::parameterChangePoint(AudioProcessorParameter& parameter, int sampleOffset, float newValue)
+{
+    const auto bit = (uint64) 1 << parameter.getParameterIndex();
 
-        delayProcessor.setEffectsParameters(
-            effectsRouting,
-            flipPhase,
-            bcDepth,
-            decimReduction,
-            decimStereoSpread,
-            lpfCutoff,
-            lpfQ,
-            lpfPosition,
-            bmLevel,
-            bmOperation,
-            bmOperands,
-            hpfCutoff,
-            hpfQ,
-            hpfPosition
-            );
+    if (&parameter == &parameters.tapTempoButton)
+    {
+        pushTapButtonState(newValue >= 0.5f, sampleOffset);
+        changingParameters |= bit;
+        return;
+    }
 
+    if (numParameterChanges == MAX_PARAMETER_CHANGES)
+    {
+        changingParameters &= ~bit;
+        return;
+    }
 
+    // after the changes at the same offset, so that the points of one parameter keep their order
+    int position = numParameterChanges;
 
-        requiresUpdate.store(false);
+    while (position > 0 && parameterChanges[(size_t) position - 1].sampleOffset > sampleOffset)
+    {
+        parameterChanges[(size_t) position] = parameterChanges[(size_t) position - 1];
+        --position;
     }
 
-    delayProcessor.processBlock(buffer);
+    parameterChanges[(size_t) position] = { sampleOffset, parameter.getParameterIndex(),
+                                            convertParameterValue(static_cast<RangedAudioParameter&>(parameter), newValue) };
+    ++numParameterChanges;
+    changingParameters |= bit;
+}
+
+float StrangeReturnsAudioProcessor::convertParameterValue(const RangedAudioParameter& parameter, float normalisedValue) const
+{
+    auto value = parameter.convertFrom0to1(normalisedValue);
+
+    if (&parameter == &parameters.noiseLevel || &parameter == &parameters.bmLevel)
+        value = Decibels::decibelsToGain(value);
+    else if (&parameter == &parameters.beatMultiply)
+        value = ParameterReferences::beatMultiplyFactor(roundToInt(value));
+
+    return value;
+}
+
+void StrangeReturnsAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+    const auto& parameter = *static_cast<RangedAudioParameter*>(getParameters()[parameterIndex]);
+    const auto value = convertParameterValue(parameter, newValue);
+
+    parameterSnapshot[(size_t) parameterIndex].store(value, std::memory_order_relaxed);
+
+    if (&parameter == &parameters.tapTempoButton && value >= 0.5f)
+        numTapButtonPresses.fetch_add(1, std::memory_order_relaxed);
+
+    markDirty(parameter);
+}
+
+void StrangeReturnsAudioProcessor::loadParameterSnapshot(uint64 dirty)
+{
+    for (int index = 0; index < MAX_NUM_PARAMETERS; ++index)
+        if ((dirty & ((uint64) 1 << index)) != 0)
+            appliedValues[(size_t) index] = parameterSnapshot[(size_t) index].load(std::memory_order_relaxed);
+}
+
+void StrangeReturnsAudioProcessor::applyParameterChanges(uint64 changed)
+{
+    auto isDirty = [changed](const AudioProcessorParameter& parameter)
+    {
+        return (changed & ((uint64) 1 << parameter.getParameterIndex())) != 0;
+    };
+
+    auto get = [this](const AudioProcessorParameter& parameter)
+    {
+        return appliedValues[(size_t) parameter.getParameterIndex()];
+    };
+
+    auto getIndex = [&get](const AudioProcessorParameter& parameter) { return roundToInt(get(parameter)); };
+
+    // the tap tempo marks the time dirty as well
+    if (isDirty(parameters.time) || isDirty(parameters.beatMultiply) || isDirty(parameters.tapTempoEnabled) || isDirty(parameters.maxTime))
+    {
+        const auto timePot_ms = getTimePot_ms();
+        const auto beatMultiplyFactor = get(parameters.beatMultiply);
+
+        const auto time_ms = get(parameters.tapTempoEnabled) >= 0.5f
+                                 ? jmax(50.0f, beatMultiplyFactor * TapTempoTime_ms + (timePot_ms - TimeAtTapTempoActivation))
+                                 : timePot_ms * beatMultiplyFactor;
+
+        delayProcessor.setTime(jmin(time_ms, get(parameters.maxTime) * 1000.0f));
+    }
+
+    if (isDirty(parameters.feedback)) delayProcessor.setFeedback(get(parameters.feedback));
+    if (isDirty(parameters.toneType)) delayProcessor.setToneType(getIndex(parameters.toneType));
+
+    if (isDirty(parameters.modRate)) delayProcessor.setModRate(get(parameters.modRate));
+    if (isDirty(parameters.modDepth)) delayProcessor.setModDepth(get(parameters.modDepth));
+    if (isDirty(parameters.modWave)) delayProcessor.setModWave(getIndex(parameters.modWave));
+    if (isDirty(parameters.modStereoPhase)) delayProcessor.setModStereoPhase(get(parameters.modStereoPhase));
+
+    if (isDirty(parameters.noiseLevel)) delayProcessor.setNoiseLevel(get(parameters.noiseLevel));
+    if (isDirty(parameters.noiseType)) delayProcessor.setNoiseType(getIndex(parameters.noiseType));
+
+    if (isDirty(parameters.effectsRouting)) delayProcessor.setEffectsRouting(getIndex(parameters.effectsRouting));
+    if (isDirty(parameters.flipPhase)) delayProcessor.setFlipPhase(get(parameters.flipPhase) >= 0.5f);
+    if (isDirty(parameters.bcDepth)) delayProcessor.setBcDepth(get(parameters.bcDepth));
+
+    if (isDirty(parameters.decimReduction)) delayProcessor.setDecimReduction(get(parameters.decimReduction));
+    if (isDirty(parameters.decimStereoSpread)) delayProcessor.setDecimStereoSpread(get(parameters.decimStereoSpread));
+
+    if (isDirty(parameters.lpfCutoff)) delayProcessor.setLpfCutoff(get(parameters.lpfCutoff));
+    if (isDirty(parameters.lpfQ)) delayProcessor.setLpfQ(get(parameters.lpfQ));
+    if (isDirty(parameters.lpfPosition)) delayProcessor.setLpfPosition(getIndex(parameters.lpfPosition));
+
+    if (isDirty(parameters.hpfCutoff)) delayProcessor.setHpfCutoff(get(parameters.hpfCutoff));
+    if (isDirty(parameters.hpfQ)) delayProcessor.setHpfQ(get(parameters.hpfQ));
+    if (isDirty(parameters.hpfPosition)) delayProcessor.setHpfPosition(getIndex(parameters.hpfPosition));
+
+    if (isDirty(parameters.bmLevel)) delayProcessor.setBmLevel(get(parameters.bmLevel));
+    if (isDirty(parameters.bmOperation)) delayProcessor.setBmOperation(getIndex(parameters.bmOperation));
+    if (isDirty(parameters.bmOperands)) delayProcessor.setBmOperands(getIndex(parameters.bmOperands));
 }
 
 //==============================================================================
@@ -201,102 +368,99 @@ AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new StrangeReturnsAudioProcessor();
 }
 
-void StrangeReturnsAudioProcessor::handleTapTempo(bool isPressed)
+void StrangeReturnsAudioProcessor::pushTapButtonState(bool isPressed, int sampleOffset)
 {
-    if (isPressed)
-    {
-        isButtonHeld = true;
-        tapTempoHeld.store(true);
-        startTimer(1000); // Démarrer le timer pour 1 seconde
-    }
-    else
-    {
-        if (tapTempoHeld.load())
-        {
-            // Si le bouton est relâché avant 1 seconde
-            isButtonHeld = false;
-            stopTimer();
-            // Gérer le tap tempo normalement
-            auto now = std::chrono::steady_clock::now();
-            std::lock_guard<std::mutex> lock(tapMutex);
-
-            // Ajoute le temps actuel aux taps
-            tapTimes.push_back(now);
-
-            // Supprime les taps plus vieux que 2 secondes
-            while (!tapTimes.empty() && std::chrono::duration_cast<std::chrono::seconds>(now - tapTimes.front()).count() > 2)
-            {
-                tapTimes.pop_front();
-            }
-
-            // Si la durée entre le dernier tap et le premier est inférieure à 2 secondes et qu'il y a au moins 2 taps
-            if (tapTimes.size() >= 2 && std::chrono::duration_cast<std::chrono::milliseconds>(tapTimes.back() - tapTimes.front()).count() <= 2000)
-            {
-                // Calcul de la moyenne des intervalles entre les taps
-                std::deque<std::chrono::steady_clock::time_point> recentTaps = tapTimes;
-                if (recentTaps.size() > 3)
-                {
-                    recentTaps.pop_front();
-                }
-
-                std::vector<float> intervals;
-                for (size_t i = 1; i < recentTaps.size(); ++i)
-                {
-                    auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(recentTaps[i] - recentTaps[i - 1]).count();
-                    intervals.push_back(static_cast<float>(interval));
-                }
-
-                if (!intervals.empty())
-                {
-                    float averageInterval = 0.0f;
-                    for (auto interval : intervals)
-                        averageInterval += interval;
-                    averageInterval /= intervals.size();
-
-                    // Mettre à jour la valeur de delay time
-                    TapTempoTime_ms = averageInterval;
-                    TimeAtTapTempoActivation = parameters.time.get();
-
-                    // Activer le mode Tap Tempo
-                    parameters.tapTempoEnabled.setValueNotifyingHost(true);
-                    DBG("Tap tempo enabled. Time : " + String(TapTempoTime_ms) + "ms");
-
-                    // Informer le DelayProcessor
-                    delayProcessor.setTapTempoTime(TapTempoTime_ms);
-                    delayProcessor.setReferencePotPosition(TimeAtTapTempoActivation);
-                    delayProcessor.setTapTempoEnabled(true);
-                    requiresUpdate.store(true);
-                }
-            }
-
-            tapTempoHeld.store(false);
-        }
-    }
+    const auto scope = tapButtonFifo.write(1);
+
+    // a full queue drops the state, the next one is taken as a new press or release anyway
+    if (scope.blockSize1 > 0)
+        tapButtonStates[(size_t) scope.startIndex1] = { isPressed, sampleOffset };
 }
 
-void StrangeReturnsAudioProcessor::parameterChanged(const juce::String &parameterID, float newValue)
+void StrangeReturnsAudioProcessor::queueTapButtonPresses(uint64 dirty)
 {
-    if (parameterID == paramID::tapTempoButton)
+    const auto bit = (uint64) 1 << parameters.tapTempoButton.getParameterIndex();
+
+    if (((dirty | changingParameters) & bit) == 0)
+        return;
+
+    const auto numPresses = numTapButtonPresses.load(std::memory_order_relaxed);
+    const auto numNewPresses = numPresses - numTapButtonPressesQueued;
+    numTapButtonPressesQueued = numPresses;
+
+    if ((changingParameters & bit) != 0)
+        return;
+
+    // A new press releases the button first, and one that isn't down any more was a whole tap.
+    const auto isPressed = appliedValues[(size_t) parameters.tapTempoButton.getParameterIndex()] >= 0.5f;
+
+    if (numNewPresses > 0)
     {
-        const bool isPressed = (newValue >= 0.5f);
-        juce::MessageManager::callAsync([this, isPressed]
+        pushTapButtonState(false, 0);
+
+        if (numNewPresses > (isPressed ? 1u : 0u))
         {
-            handleTapTempo(isPressed);
-        });
+            pushTapButtonState(true, 0);
+            pushTapButtonState(false, 0);
+        }
     }
-    requiresUpdate.store(true);
+
+    pushTapButtonState(isPressed, 0);
 }
 
 void StrangeReturnsAudioProcessor::timerCallback()
 {
-    if (isButtonHeld)
+    const auto isEnabled = tapTempoEnabledForHost.exchange(-1, std::memory_order_relaxed);
+
+    if (isEnabled < 0)
+        return;
+
+    parameters.tapTempoEnabled.beginChangeGesture();
+    parameters.tapTempoEnabled.setValueNotifyingHost(isEnabled != 0 ? 1.0f : 0.0f);
+    parameters.tapTempoEnabled.endChangeGesture();
+}
+
+void StrangeReturnsAudioProcessor::processTapTempo(int numSamples)
+{
+    auto handle = [this](TapTempo::Event event)
     {
-        // Si le bouton est maintenu pendant plus d'une seconde, désactiver Tap Tempo
-        DBG("Tap Tempo disabled");
-        parameters.tapTempoEnabled.setValueNotifyingHost(false);
-        delayProcessor.setTapTempoEnabled(false);
-        isButtonHeld = false;
-        tapTempoHeld.store(false);
-        stopTimer();
-    }
+        if (event == TapTempo::Event::TAPPED)
+        {
+            TapTempoTime_ms = tapTempo.getTapTime_ms();
+            TimeAtTapTempoActivation = getTimePot_ms();
+
+            delayProcessor.setTapTempoTime(TapTempoTime_ms);
+            delayProcessor.setReferencePotPosition(TimeAtTapTempoActivation);
+            delayProcessor.setTapTempoEnabled(true);
+
+            // if it was already enabled, the new tap time still needs the time to be recomputed
+            appliedValues[(size_t) parameters.tapTempoEnabled.getParameterIndex()] = 1.0f;
+            tapTempoEnabledForHost.store(1, std::memory_order_relaxed);
+            markDirty(parameters.time);
+        }
+        else if (event == TapTempo::Event::HELD)
+        {
+            delayProcessor.setTapTempoEnabled(false);
+
+            appliedValues[(size_t) parameters.tapTempoEnabled.getParameterIndex()] = 0.0f;
+            tapTempoEnabledForHost.store(0, std::memory_order_relaxed);
+            markDirty(parameters.time);
+        }
+    };
+
+    auto setButtonState = [&](int index)
+    {
+        const auto& state = tapButtonStates[(size_t) index];
+        handle(tapTempo.setButtonState(state.isPressed, jlimit(0, numSamples, state.sampleOffset)));
+    };
+
+    const auto scope = tapButtonFifo.read(tapButtonFifo.getNumReady());
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        setButtonState(scope.startIndex1 + i);
+
+    for (int i = 0; i < scope.blockSize2; ++i)
+        setButtonState(scope.startIndex2 + i);
+
+    handle(tapTempo.advance(numSamples));
 }
@@ -1,12 +1,12 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
-#include <deque>
-#include <chrono>
-#include <mutex>
+#include <array>
+#include <atomic>
 
 #include "Constants.h"
 #include "DelayProcessor.h"
+#include "TapTempo.h"
 
 using namespace juce;
 
@@ -22,11 +22,13 @@ namespace paramID
     PARAMETER_ID(tapTempoEnabled)
     PARAMETER_ID(tapTempoButton)
     PARAMETER_ID(beatMultiply)
+    PARAMETER_ID(maxTime)
 
     // MODULATION
     PARAMETER_ID(modRate)
     PARAMETER_ID(modDepth)
     PARAMETER_ID(modWave)
+    PARAMETER_ID(modStereoPhase)
 
     // NOISE
     PARAMETER_ID(noiseLevel)
@@ -68,8 +70,8 @@ noexcept (noexcept (std::initializer_list<int> { (func(std::forward<Items>(items
 }
 
 class StrangeReturnsAudioProcessor : public juce::AudioProcessor,
-                                     private ValueTree::Listener,
-                                     private AudioProcessorValueTreeState::Listener,
+                                     public VST3ClientExtensions,
+                                     private AudioProcessorParameter::Listener,
                                      private Timer
 {
 public:
@@ -87,6 +89,18 @@ public:
    #endif
 
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
+    void processBlockBypassed (AudioBuffer<float>&, MidiBuffer&) override;
+
+    // The VST3 wrapper reports every automation point, the block is then split so that each one lands on its sample.
+    // The points of a call that wasn't followed by processBlock() are dropped with the next one, the tap button's too.
+    bool wantsParameterChangePoints() const override { return true; }
+    void parameterChangePoint(AudioProcessorParameter& parameter, int sampleOffset, float newValue) override;
+    void beginParameterChangePoints() override;
+
+    // and its silence flags, a silent input isn't even read and an idle output is reported silent
+    bool wantsSilenceFlags() const override { return true; }
+    void setInputSilenceFlags(uint64 flags) override { inputSilenceFlags = flags; }
+    uint64 getOutputSilenceFlags() const override { return outputSilenceFlags; }
 
     //==============================================================================
     AudioProcessorEditor* createEditor() override;
@@ -98,7 +112,7 @@ public:
     bool acceptsMidi() const override;
     bool producesMidi() const override;
     bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override { return 0.0; };
+    double getTailLengthSeconds() const override { return delayProcessor.getTailLengthSeconds(); };
 
     //==============================================================================
     int getNumPrograms() override { return 1; };
@@ -143,6 +157,7 @@ public:
         //     return String(x, 2);
         // }
 
+        // the choice names, beatMultiplyFactor() has their values
         static const StringArray beatMultiplyOptions()
         {
             return StringArray{
@@ -158,6 +173,26 @@ public:
             };
         }
 
+        static float beatMultiplyFactor(int index)
+        {
+            static constexpr float factors[] { 0.25f, 1.0f / 3.0f, 0.5f, 2.0f / 3.0f, 0.75f, 1.0f, 1.25f, 4.0f / 3.0f, 1.5f };
+            return factors[jlimit(0, numElementsInArray(factors) - 1, index)];
+        }
+
+        // The time parameter keeps the range of the existing automation, up to MAX_DELAY_TIME_SEC. The Max Time
+        // setting stretches it, so that the end of the knob's travel is maxTime_sec.
+        static constexpr float MIN_TIME_MS = 50.0f;
+
+        static float stretchTime(float time_ms, float maxTime_sec)
+        {
+            return MIN_TIME_MS + (time_ms - MIN_TIME_MS) * (maxTime_sec * 1000.0f - MIN_TIME_MS) / (MAX_DELAY_TIME_SEC * 1000.0f - MIN_TIME_MS);
+        }
+
+        static float unstretchTime(float stretchedTime_ms, float maxTime_sec)
+        {
+            return MIN_TIME_MS + (stretchedTime_ms - MIN_TIME_MS) * (MAX_DELAY_TIME_SEC * 1000.0f - MIN_TIME_MS) / (maxTime_sec * 1000.0f - MIN_TIME_MS);
+        }
+
         static const StringArray toneTypeOptions() { return StringArray{ "DIGITAL", "TAPE" }; }
 
         static const StringArray effectsRoutingOptions() { return StringArray{ "IN", "OUT" }; }
@@ -173,7 +208,9 @@ public:
         static const StringArray bmOperandsOptions() { return StringArray{ "POST FX + POST FX", "PRE FX + POST FX", "DRY + POST FX" }; }
 
         explicit ParameterReferences(AudioProcessorValueTreeState::ParameterLayout& layout)
-            : time(addToLayout(layout, std::make_unique<Parameter>(paramID::time, "Time", "ms", NormalisableRange<float>(50.0f, MAX_DELAY_TIME_SEC * 1000.0f, 1.0f, 0.5f), 100.0f, valueToTextFunction, textToValueFunction))),
+            : time(addToLayout(layout, std::make_unique<Parameter>(paramID::time, "Time", "ms", NormalisableRange<float>(MIN_TIME_MS, MAX_DELAY_TIME_SEC * 1000.0f, 1.0f, 0.5f), 100.0f,
+                                                                     [this](float x) { return valueToTextFunction(stretchTime(x, maxTime.get())); },
+                                                                     [this](const String& str) { return unstretchTime(textToValueFunction(str), maxTime.get()); }))),
               feedback(addToLayout(layout, std::make_unique<Parameter>(paramID::feedback, "Feedback", "%", NormalisableRange<float>(0.0f, 100.0f), 0.0f, valueToTextFunction, textToValueFunction))),
               beatMultiply(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::beatMultiply, "Beat Multiply", beatMultiplyOptions(), 6))),
               toneType(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::toneType, "Type", toneTypeOptions(), 0))),
@@ -183,6 +220,7 @@ public:
               modRate(addToLayout(layout, std::make_unique<Parameter>(paramID::modRate, "Mod Rate", "Hz", NormalisableRange<float>(MIN_MOD_RATE_HZ, MAX_MOD_RATE_HZ), MIN_MOD_RATE_HZ, valueToTextFunction, textToValueFunction))),
               modDepth(addToLayout(layout, std::make_unique<Parameter>(paramID::modDepth, "Mod Depth", "%", NormalisableRange<float>(0.0f, 100.0f), 0.0f, valueToTextFunction, textToValueFunction))),
               modWave(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::modWave, "Mod Wave", modWaveOptions(), 1))),
+              modStereoPhase(addToLayout(layout, std::make_unique<Parameter>(paramID::modStereoPhase, "Mod Stereo Phase", "deg", NormalisableRange<float>(0.0f, MAX_MOD_STEREO_PHASE_DEG), 0.0f, valueToTextFunction, textToValueFunction))),
 
               noiseLevel(addToLayout(layout, std::make_unique<Parameter>(paramID::noiseLevel, "Noise Level", "dB", NormalisableRange<float>(MIN_NOISE_LEVEL_DB, MAX_NOISE_LEVEL_DB), MIN_NOISE_LEVEL_DB, valueToTextFunction, textToValueFunction))),
               noiseType(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::noiseType, "Noise Type", noiseTypeOptions(), 0))),
@@ -204,7 +242,9 @@ public:
 
               bmLevel(addToLayout(layout, std::make_unique<Parameter>(paramID::bmLevel, "BitMod Level", "dB", NormalisableRange<float> (MIN_GAIN_DB, MAX_GAIN_DB), MIN_GAIN_DB, valueToTextFunction, textToValueFunction))),
               bmOperation(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::bmOperation, "BitMod Operation", bmOperationOptions(), 0))),
-              bmOperands(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::bmOperands, "BitMod Operands", bmOperandsOptions(), 0)))
+              bmOperands(addToLayout(layout, std::make_unique<AudioParameterChoice>(paramID::bmOperands, "BitMod Operands", bmOperandsOptions(), 0))),
+
+              maxTime(addToLayout(layout, std::make_unique<Parameter>(paramID::maxTime, "Max Time", "s", NormalisableRange<float>((float) MAX_DELAY_TIME_SEC, MAX_DELAY_TIME_LIMIT_SEC, 1.0f), (float) MAX_DELAY_TIME_SEC, valueToTextFunction, textToValueFunction, false, false)))
         {}
 
         Parameter& time;
@@ -218,6 +258,7 @@ public:
         Parameter& modRate;
         Parameter& modDepth;
         AudioParameterChoice& modWave;
+        Parameter& modStereoPhase;
 
         Parameter& noiseLevel;
         AudioParameterChoice& noiseType;
@@ -240,33 +281,112 @@ public:
         Parameter& bmLevel;
         AudioParameterChoice& bmOperation;
         AudioParameterChoice& bmOperands;
+
+        // a setting rather than something to automate, last so that the others keep their indices
+        Parameter& maxTime;
     };
 
     const ParameterReferences& getParameterValues() const noexcept { return parameters; }
     AudioProcessorValueTreeState& getVts() { return vts; }
 
-    void handleTapTempo(bool isPressed);
-
 private:
-    void parameterChanged(const juce::String& parameterID, float newValue) override;
-    void valueTreePropertyChanged(ValueTree&, const Identifier&) override
+    // Parameter changes, from whichever thread makes them, are converted once into what DelayProcessor takes
+    // (gains instead of dB, the beat multiply factor instead of its choice) and stored by parameter index.
+    // The audio thread then only applies the parameters whose bits it finds in dirtyParameters.
+    static constexpr int MAX_NUM_PARAMETERS = 64;
+
+    // written by the message thread, see CacheLinePadded
+    CacheLinePadded<std::array<std::atomic<float>, MAX_NUM_PARAMETERS>> parameterSnapshot;
+    CacheLinePadded<std::atomic<uint64>> dirtyParameters { 0 };
+
+    // audio thread only, the values as they were last applied
+    std::array<float, MAX_NUM_PARAMETERS> appliedValues {};
+
+    void parameterValueChanged(int parameterIndex, float newValue) override;
+    void parameterGestureChanged(int, bool) override {}
+
+    float convertParameterValue(const RangedAudioParameter& parameter, float normalisedValue) const;
+
+    void markDirty(const AudioProcessorParameter& parameter)
+    {
+        dirtyParameters.fetch_or((uint64) 1 << parameter.getParameterIndex(), std::memory_order_release);
+    }
+
+    // the time knob's position, as stretched by the Max Time setting
+    float getTimePot_ms() const
     {
-        requiresUpdate.store(true);
+        return ParameterReferences::stretchTime(appliedValues[(size_t) parameters.time.getParameterIndex()],
+                                                appliedValues[(size_t) parameters.maxTime.getParameterIndex()]);
     }
 
+    void loadParameterSnapshot(uint64 dirty);
+    void applyParameterChanges(uint64 changed);
+
+    // The automation points of the coming block, in the order of their offsets. The parameters that have some
+    // put off their dirty bits until the end of the block: their snapshot is their last point, unless the editor
+    // has changed them since.
+    struct ParameterChange
+    {
+        int sampleOffset;
+        int parameterIndex;
+        float value;
+    };
+
+    static constexpr int MAX_PARAMETER_CHANGES = 1024;
+
+    std::array<ParameterChange, MAX_PARAMETER_CHANGES> parameterChanges;
+    int numParameterChanges = 0;
+    uint64 changingParameters = 0;
+
+    void processBlockBetweenChanges(AudioBuffer<float>& buffer);
+
+    void clearParameterChanges()
+    {
+        numParameterChanges = 0;
+        changingParameters = 0;
+    }
+
+    // one bit per channel of the main buses, only set by the VST3 wrapper
+    uint64 inputSilenceFlags = 0;
+    uint64 outputSilenceFlags = 0;
+
     // Tap Tempo
-    std::deque<std::chrono::steady_clock::time_point> tapTimes;
-    std::mutex tapMutex;
-    bool TapTempoEnabled = false;
+    // The button's presses and releases are queued for the audio thread, which times them and is the only one
+    // to write the queue: the host's points with their offsets, then at the start of the block whatever
+    // parameterValueChanged() saw. That one counts the presses, so that a tap shorter than a block isn't lost.
+    // When the button has points, the presses counted meanwhile are theirs.
+    static constexpr int TAP_BUTTON_QUEUE_SIZE = 32;
+
+    struct TapButtonState
+    {
+        bool isPressed;
+        int sampleOffset;
+    };
+
+    AbstractFifo tapButtonFifo { TAP_BUTTON_QUEUE_SIZE };
+    std::array<TapButtonState, TAP_BUTTON_QUEUE_SIZE> tapButtonStates {};
+
+    std::atomic<uint32> numTapButtonPresses { 0 };
+
+    // The taps switch the tap tempo on and off right away, the parameter follows on the message thread in a
+    // gesture, so that hosts record it and its listeners aren't called from processBlock(). -1 when it's up to date.
+    static constexpr int TAP_TEMPO_TIMER_HZ = 30;
+    std::atomic<int> tapTempoEnabledForHost { -1 };
+
+    void timerCallback() override;
+
+    // audio thread only
+    uint32 numTapButtonPressesQueued = 0;
+    TapTempo tapTempo;
     float TapTempoTime_ms = -1.0f;
     float TimeAtTapTempoActivation = -1.0f;
-    bool isButtonHeld = false;
-    std::atomic<bool> tapTempoHeld{ false };
-    void timerCallback() override;
+
+    void pushTapButtonState(bool isPressed, int sampleOffset);
+    void queueTapButtonPresses(uint64 dirty);
+    void processTapTempo(int numSamples);
 
     ParameterReferences parameters;
     AudioProcessorValueTreeState vts;
-    std::atomic<bool> requiresUpdate{ true };
 
     DelayProcessor delayProcessor;
 
@@ -0,0 +1,59 @@
+#include "ProcessorUtils.h"
+
+const FractionalDelayTable& FractionalDelayTable::getInstance()
+{
+    static const FractionalDelayTable table;
+    return table;
+}
+
+FractionalDelayTable::FractionalDelayTable()
+{
+    constexpr int halfLength = NUM_TAPS / 2;
+
+    auto besselI0 = [](double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    };
+
+    float phaseWeights[NUM_PHASES + 1][NUM_TAPS];
+
+    for (int phase = 0; phase <= NUM_PHASES; ++phase)
+    {
+        const auto fraction = (double) phase / NUM_PHASES;
+        double sum = 0.0;
+        double w[NUM_TAPS];
+
+        for (int k = 0; k < NUM_TAPS; ++k)
+        {
+            // distance of tap k from the read position
+            const auto x = (double) (k - (halfLength - 1)) - fraction;
+            const auto r = x / halfLength;
+            const auto window = besselI0(KAISER_BETA * std::sqrt(jmax(0.0, 1.0 - r * r))) / besselI0(KAISER_BETA);
+            const auto sinc = x == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+
+            w[k] = sinc * window;
+            sum += w[k];
+        }
+
+        // unity gain at DC for every fraction
+        for (int k = 0; k < NUM_TAPS; ++k)
+            phaseWeights[phase][k] = (float) (w[k] / sum);
+    }
+
+    for (int phase = 0; phase < NUM_PHASES; ++phase)
+    {
+        for (int k = 0; k < NUM_TAPS; ++k)
+        {
+            weights[phase][k] = phaseWeights[phase][k];
+            slopes[phase][k] = phaseWeights[phase + 1][k] - phaseWeights[phase][k];
+        }
+    }
+}
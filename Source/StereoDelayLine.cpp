@@ -0,0 +1,244 @@
+#include "StereoDelayLine.h"
+
+StereoDelayLine::~StereoDelayLine()
+{
+    if (isRegistered)
+        growthThread->removeTimeSliceClient(this);
+}
+
+void StereoDelayLine::prepare(float initialDelay_smpls, float maxDelay_smpls, CircularBuffer::Storage storage, void* const* lineMemory,
+                              bool lockGrownLines)
+{
+    release();
+
+    maxLength = jmax(getLengthFor(maxDelay_smpls), getLengthFor(initialDelay_smpls));
+    wantedLength = getLengthFor(initialDelay_smpls);
+    shouldLock = lockGrownLines;
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        lines[channel].createCircularBuffer((unsigned int) wantedLength, storage, lineMemory[channel]);
+
+    numSamplesWritten.store(0, std::memory_order_relaxed);
+    growthState.store(IDLE, std::memory_order_relaxed);
+
+    growthThread->addTimeSliceClient(this);
+    isRegistered = true;
+}
+
+void StereoDelayLine::release()
+{
+    if (isRegistered)
+    {
+        growthThread->removeTimeSliceClient(this);
+        isRegistered = false;
+    }
+
+    for (auto& line : lines)
+    {
+        CircularBuffer none;
+        line.swap(none);
+    }
+
+    freeSpareLines();
+    linesArena.release();
+}
+
+void StereoDelayLine::reset()
+{
+    jassert(isRegistered);
+
+    // waits for a growth that might be running, the spare lines are either empty or copies of what goes now
+    growthThread->removeTimeSliceClient(this);
+
+    if (growthState.load(std::memory_order_acquire) != IDLE)
+        freeSpareLines();
+
+    const auto position = numSamplesWritten.load(std::memory_order_relaxed);
+    const auto numWritten = (unsigned int) jmin(position, (uint64) getLength());
+
+    for (auto& line : lines)
+    {
+        line.clear(position - numWritten, numWritten);
+        line.setWritePosition(0);
+    }
+
+    numSamplesWritten.store(0, std::memory_order_relaxed);
+    growthState.store(IDLE, std::memory_order_relaxed);
+
+    growthThread->addTimeSliceClient(this);
+}
+
+void StereoDelayLine::freeSpareLines()
+{
+    for (auto& line : spareLines)
+    {
+        CircularBuffer none;
+        line.swap(none);
+    }
+
+    spareArena.release();
+}
+
+void StereoDelayLine::takeSnapshot(Snapshot& snapshot, int numSamples, float threshold) const
+{
+    numSamples = jmin(numSamples, getLength());
+
+    // the oldest sample above the threshold, the silence before it doesn't need keeping
+    int start = numSamples;
+
+    for (const auto& line : lines)
+        for (int i = 0; i < start; ++i)
+            if (std::abs(line.readBuffer(numSamples - i)) > threshold)
+                start = i;
+
+    snapshot.clear();
+    snapshot.numSamples = numSamples - start;
+
+    if (snapshot.isEmpty())
+        return;
+
+    snapshot.samples.malloc(NUM_CHANNELS * snapshot.numSamples);
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        auto* dest = snapshot.samples + channel * snapshot.numSamples;
+
+        for (int i = 0; i < snapshot.numSamples; ++i)
+            dest[i] = toBFloat16(lines[channel].readBuffer(snapshot.numSamples - i));
+    }
+}
+
+void StereoDelayLine::restoreSnapshot(const Snapshot& snapshot)
+{
+    const auto numSamples = jmin(snapshot.numSamples, getLength());
+    constexpr int chunkSize = 256;
+
+    float chunk[NUM_CHANNELS][chunkSize];
+    float* x[NUM_CHANNELS];
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        x[channel] = chunk[channel];
+
+    for (int done = snapshot.numSamples - numSamples; done < snapshot.numSamples; done += chunkSize)
+    {
+        const int count = jmin(chunkSize, snapshot.numSamples - done);
+
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        {
+            const auto* source = snapshot.samples + channel * snapshot.numSamples + done;
+
+            for (int i = 0; i < count; ++i)
+                chunk[channel][i] = toFloat(source[i]);
+        }
+
+        writeBlock(x, count);
+    }
+}
+
+int StereoDelayLine::getLengthFor(float delay_smpls)
+{
+    return nextPowerOfTwo((int) std::ceil(delay_smpls) + CircularBuffer::MAX_TAPS_AHEAD);
+}
+
+void StereoDelayLine::requestDelay(float delay_smpls) noexcept
+{
+    if (delay_smpls > (float) getMaxDelay())
+        wantedLength = jmax(wantedLength, jmin(maxLength, getLengthFor(delay_smpls)));
+}
+
+bool StereoDelayLine::update(int numSamples)
+{
+    auto state = growthState.load(std::memory_order_acquire);
+
+    if (state == IDLE && wantedLength > getLength())
+    {
+        growLength = wantedLength;
+
+        if (isRealtime)
+        {
+            growthState.store(REQUESTED, std::memory_order_release);
+            return false;
+        }
+
+        // the background thread leaves IDLE lines alone
+        grow();
+        state = READY;
+    }
+
+    const auto position = numSamplesWritten.load(std::memory_order_relaxed);
+    const auto length = (uint64) getLength();
+
+    if (state == READY)
+    {
+        // the whole history, what lies beyond it in the longer lines stays silent
+        copiedUpTo = position - jmin(position, length);
+        positionAtLastUpdate = position;
+        state = COPYING;
+        growthState.store(COPYING, std::memory_order_relaxed);
+    }
+
+    if (state != COPYING)
+        return false;
+
+    // What was written since the last update() and what the coming block writes, plus a chunk: the copy stays
+    // ahead of the writes that go round the lines and catches up with them. Offline it's done at once.
+    const auto numLeft = position - copiedUpTo;
+    const auto budget = position - positionAtLastUpdate + (uint64) numSamples + (uint64) COPY_CHUNK_SIZE;
+    const auto numToCopy = isRealtime ? jmin(numLeft, budget) : numLeft;
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        spareLines[channel].copyFrom(lines[channel], copiedUpTo + numToCopy, (unsigned int) numToCopy);
+
+    copiedUpTo += numToCopy;
+    positionAtLastUpdate = position;
+
+    if (copiedUpTo < position)
+        return false;
+
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+    {
+        spareLines[channel].setWritePosition(position);
+        lines[channel].swap(spareLines[channel]);
+    }
+
+    linesArena.swap(spareArena);
+
+    growthState.store(RETIRED, std::memory_order_release);
+    return true;
+}
+
+void StereoDelayLine::grow()
+{
+    const auto storage = lines[0].getStorage();
+
+    DspArena::Layout layout;
+    size_t offsets[NUM_CHANNELS];
+
+    for (auto& offset : offsets)
+        offset = layout.add<char>(CircularBuffer::getMemorySize((unsigned int) growLength, storage));
+
+    spareArena.allocate(layout, shouldLock);
+
+    // cleared, the current lines are only read by the audio thread that writes them
+    for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        spareLines[channel].createCircularBuffer((unsigned int) growLength, storage, spareArena.get<char>(offsets[channel]));
+}
+
+int StereoDelayLine::useTimeSlice()
+{
+    const auto state = growthState.load(std::memory_order_acquire);
+
+    if (state == REQUESTED)
+    {
+        grow();
+        growthState.store(READY, std::memory_order_release);
+    }
+    else if (state == RETIRED)
+    {
+        freeSpareLines();
+        growthState.store(IDLE, std::memory_order_release);
+    }
+
+    // a request waits 10 ms at most, the time parameter takes 250 ms to ramp anyway
+    return 10;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+
+#include <juce_core/juce_core.h>
+
+#include "Constants.h"
+#include "DspArena.h"
+#include "ProcessorUtils.h"
+
+using namespace juce;
+
+// The delay lines of both channels. They start out as long as the delay given to prepare() needs and grow on a
+// shared background thread when a longer one is asked for, up to the maximum.
+// A growth allocates and clears the longer lines on the background thread. update() then copies the history into
+// them, a chunk per block so that no block pays for all of it, and swaps the lines once the copy caught up with the
+// writes. The current lines are only ever touched by the audio thread. The old lines are freed on the background
+// thread as well. The grown lines get their own DspArena.
+class StereoDelayLine : private TimeSliceClient
+{
+public:
+    StereoDelayLine() {}
+    ~StereoDelayLine() override;
+
+    // the memory prepare() needs for each line
+    static size_t getLineMemorySize(float initialDelay_smpls, CircularBuffer::Storage storage)
+    {
+        return CircularBuffer::getMemorySize((unsigned int) getLengthFor(initialDelay_smpls), storage);
+    }
+
+    // Sets lines for delays of up to initialDelay_smpls up in lineMemory, NUM_CHANNELS blocks of getLineMemorySize()
+    // bytes owned by the caller. Delays up to maxDelay_smpls can be asked for later, the grown lines are locked into
+    // RAM if lockGrownLines.
+    void prepare(float initialDelay_smpls, float maxDelay_smpls, CircularBuffer::Storage storage, void* const* lineMemory,
+                 bool lockGrownLines);
+
+    // waits for a growth that might be running and frees the grown lines, the lines are unusable until prepare()
+    void release();
+
+    // Clears the lines as prepare() would, keeping their memory: only as much as was written since is cleared. A
+    // growth under way is dropped and asked for again at the next update().
+    void reset();
+
+    // The latest samples of both lines as bfloat16, from the oldest one above a threshold on. It keeps a tail while
+    // the lines are released.
+    class Snapshot
+    {
+    public:
+        bool isEmpty() const { return numSamples == 0; }
+        size_t getMemorySize() const { return (size_t) (NUM_CHANNELS * numSamples) * sizeof(uint16); }
+
+        void clear()
+        {
+            samples.free();
+            numSamples = 0;
+        }
+
+    private:
+        friend class StereoDelayLine;
+
+        // channel after channel, the oldest sample first
+        HeapBlock<uint16> samples;
+        int numSamples = 0;
+    };
+
+    // of the latest numSamples at most
+    void takeSnapshot(Snapshot& snapshot, int numSamples, float threshold) const;
+
+    // writes the snapshot back as the latest samples, as far as the lines reach
+    void restoreSnapshot(const Snapshot& snapshot);
+
+    // the longest delay the current lines can read, including the modulation
+    int getMaxDelay() const { return lines[0].getMaxDelay(); }
+    int getLength() const { return lines[0].getBufferLength(); }
+    CircularBuffer::Storage getStorage() const { return lines[0].getStorage(); }
+
+    // the memory of the lines grown since prepare()
+    size_t getGrownMemorySize() const { return linesArena.getSize(); }
+
+    // Asks for lines that can read delay_smpls, limited to the maximum. The growth starts at the next update().
+    void requestDelay(float delay_smpls) noexcept;
+
+    // Called by the audio thread before each block of numSamples is written. Swaps grown lines in and returns true
+    // if it did.
+    bool update(int numSamples);
+
+    // Offline the lines grow within update(), so that a render doesn't depend on how soon the background thread
+    // gets to run.
+    void setRealtime(bool _isRealtime) noexcept { isRealtime = _isRealtime; }
+
+    // as CircularBuffer::readBlock()
+    void readBlock(int channel, const float* delays, const float* offsets, float* dest, int numSamples,
+                   CircularBuffer::Interpolation interpolation)
+    {
+        lines[channel].readBlock(delays, offsets, dest, numSamples, interpolation);
+    }
+
+    void writeBlock(const float* const* x, int numSamples) noexcept
+    {
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            lines[channel].writeBlock(x[channel], numSamples);
+
+        numSamplesWritten.store(numSamplesWritten.load(std::memory_order_relaxed) + (uint64) numSamples, std::memory_order_release);
+    }
+
+private:
+    enum GrowthState
+    {
+        IDLE,
+        REQUESTED,      // the background thread allocates the longer lines into spareLines
+        READY,          // spareLines wait for update()
+        COPYING,        // update() copies the history into spareLines
+        RETIRED         // spareLines hold the old lines, the background thread frees them
+    };
+
+    CircularBuffer lines[NUM_CHANNELS];
+
+    // only touched by the audio thread
+    int maxLength = 0;
+    int wantedLength = 0;
+    bool isRealtime = true;
+    bool shouldLock = false;
+
+    // shared with the background thread, see CacheLinePadded
+    CacheLinePadded<std::atomic<int>> growthState { IDLE };
+    CacheLinePadded<std::atomic<uint64>> numSamplesWritten { 0 };
+
+    CircularBuffer spareLines[NUM_CHANNELS];
+
+    // empty until the lines first grow, the initial ones live in the caller's memory
+    DspArena linesArena;
+    DspArena spareArena;
+
+    // set by update() while REQUESTED is stored and read by the background thread
+    int growLength = 0;
+
+    // audio thread only, while COPYING
+    static constexpr int COPY_CHUNK_SIZE = 16384;
+    uint64 copiedUpTo = 0;
+    uint64 positionAtLastUpdate = 0;
+
+    struct GrowthThread : public TimeSliceThread
+    {
+        GrowthThread() : TimeSliceThread("StrangeReturns delay line growth") { startThread(); }
+        ~GrowthThread() override { stopThread(1000); }
+    };
+
+    SharedResourcePointer<GrowthThread> growthThread;
+    bool isRegistered = false;
+
+    static int getLengthFor(float delay_smpls);
+
+    void grow();
+    void freeSpareLines();
+    int useTimeSlice() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoDelayLine)
+};
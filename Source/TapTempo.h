@@ -0,0 +1,116 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+using namespace juce;
+
+// Tap tempo counted in samples, run by the audio thread without any clock, lock or allocation.
+// A tap is timed when the button is pressed and counted when it is released, unless the button was held for
+// HOLD_TIME_SEC, which disables the tap tempo instead. The tap time averages the intervals of the last
+// MAX_TAPS taps that are less than TAP_WINDOW_SEC apart.
+class TapTempo
+{
+public:
+    static constexpr double HOLD_TIME_SEC = 1.0;
+    static constexpr double TAP_WINDOW_SEC = 2.0;
+
+    enum class Event
+    {
+        NONE,
+        TAPPED,
+        HELD
+    };
+
+    TapTempo() {}
+
+    void prepare(double sampleRate)
+    {
+        fs = sampleRate;
+        holdTime_smpls = (int64) (HOLD_TIME_SEC * sampleRate);
+        tapWindow_smpls = (int64) (TAP_WINDOW_SEC * sampleRate);
+
+        now = 0;
+        isPressed = false;
+        numTaps = 0;
+    }
+
+    // the button's state from offset samples into the current block on
+    Event setButtonState(bool pressed, int offset) noexcept
+    {
+        if (pressed == isPressed)
+            return Event::NONE;
+
+        isPressed = pressed;
+
+        if (pressed)
+        {
+            pressTime = now + offset;
+            wasHeld = false;
+            return Event::NONE;
+        }
+
+        return wasHeld ? Event::NONE : addTap(pressTime);
+    }
+
+    // moves on to the next block, reporting a hold once when the button has been down long enough
+    Event advance(int numSamples) noexcept
+    {
+        now += numSamples;
+
+        if (isPressed && ! wasHeld && now - pressTime >= holdTime_smpls)
+        {
+            wasHeld = true;
+            numTaps = 0;
+            return Event::HELD;
+        }
+
+        return Event::NONE;
+    }
+
+    // valid after a TAPPED event
+    float getTapTime_ms() const noexcept { return tapTime_ms; }
+
+private:
+    static constexpr int MAX_TAPS = 3;
+
+    double fs = 44100.0;
+    int64 holdTime_smpls = 0;
+    int64 tapWindow_smpls = 0;
+
+    // samples since prepare()
+    int64 now = 0;
+
+    bool isPressed = false;
+    bool wasHeld = false;
+    int64 pressTime = 0;
+
+    // the last taps, oldest first
+    int64 taps[MAX_TAPS] {};
+    int numTaps = 0;
+
+    float tapTime_ms = 0.0f;
+
+    Event addTap(int64 time) noexcept
+    {
+        if (numTaps > 0 && time - taps[numTaps - 1] > tapWindow_smpls)
+            numTaps = 0;
+
+        if (numTaps == MAX_TAPS)
+        {
+            for (int i = 1; i < MAX_TAPS; ++i)
+                taps[i - 1] = taps[i];
+
+            --numTaps;
+        }
+
+        taps[numTaps++] = time;
+
+        if (numTaps < 2)
+            return Event::NONE;
+
+        tapTime_ms = (float) ((double) (taps[numTaps - 1] - taps[0]) / (numTaps - 1) * 1000.0 / fs);
+        return Event::TAPPED;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TapTempo)
+};
@@ -1,48 +1,144 @@
 #include "VASVFilter.h"
 
-inline static float peakGainForQ(float q)
+// The gain that takes the resonance peak q^2 / sqrt(q^2 - 1/4) halfway back to unity in dB, i.e. 1 / sqrt(peak).
+// Same as going through gainToDecibels and decibelsToGain, without the log and pow.
+inline static float halfPeakGainForQ(float q)
 {
-    if (q <= 0.707)
+    if (q <= 0.707f)
         return 1.0f;
     
     auto q2 = q * q;
-    return q2 / std::pow(q2 - 0.25f, 0.5f);
+    return jmin(1.0f, std::sqrt(std::sqrt(q2 - 0.25f) / q2));
 }
 
-void StaticVASVFilter::calcCoeffs()
+const VASVFilterCutoffTable& VASVFilterCutoffTable::getInstance()
 {
-    alpha = dsp::FastMathApproximations::tan((MathConstants<float>::pi * fc) / fs);
+    static const VASVFilterCutoffTable table;
+    return table;
+}
+
+VASVFilterCutoffTable::VASVFilterCutoffTable()
+{
+    entries[0] = { 0.0f, 0.0f };
+    
+    for (int i = 1; i <= TABLE_SIZE; ++i)
+    {
+        // sigma = 4 fc^2 / (alpha fs^2), written with the normalised cutoff w = fc / fs
+        const auto w = (double) i * MAX_NORMALISED_CUTOFF / TABLE_SIZE;
+        const auto alpha = std::tan(MathConstants<double>::pi * w);
+        entries[i] = { (float) alpha, (float) (4.0 * w * w / alpha) };
+    }
+}
+
+void VASVFilterCoeffs::calculate(float fc, float q, float fs)
+{
+    VASVFilterCutoffTable::getInstance().lookup(fc / fs, alpha, sigma);
+    
     r = 1.0f / (2.0f * q);
     rho = 2.0f * r + alpha;
     alpha_0 = 1.0f / (1.0f + 2.0f * r * alpha + alpha * alpha);
-    sigma = (4.0f * fc * fc) / (alpha * fs * fs);
+    halfPeak = halfPeakGainForQ(q);
+}
+
+VASVFilterCoeffs VASVFilterCoeffs::getIncrement(const VASVFilterCoeffs& target, int numSteps) const
+{
+    const auto scale = 1.0f / (float) numSteps;
     
-    halfPeak = 1.0f;
-    auto peak_dB = Decibels::gainToDecibels(peakGainForQ(q));
-    if (peak_dB > 0.0f)
-        halfPeak = Decibels::decibelsToGain(-peak_dB * 0.5f);
+    VASVFilterCoeffs increment;
+    increment.halfPeak = (target.halfPeak - halfPeak) * scale;
+    increment.alpha = (target.alpha - alpha) * scale;
+    increment.alpha_0 = (target.alpha_0 - alpha_0) * scale;
+    increment.r = (target.r - r) * scale;
+    increment.rho = (target.rho - rho) * scale;
+    increment.sigma = (target.sigma - sigma) * scale;
+    return increment;
+}
+
+void VASVFilterCoeffs::advance(const VASVFilterCoeffs& increment)
+{
+    halfPeak += increment.halfPeak;
+    alpha += increment.alpha;
+    alpha_0 += increment.alpha_0;
+    r += increment.r;
+    rho += increment.rho;
+    sigma += increment.sigma;
 }
 
 float StaticVASVFilter::processSample(float x)
 {
+    const auto& c = coeffs;
+    
     if (enableGainComp)
-        x *= halfPeak;
+        x *= c.halfPeak;
     
-    auto hpf = alpha_0 * (x - rho * sn_1 - sn_2);
-    auto bpf = alpha * hpf + sn_1;
+    auto hpf = c.alpha_0 * (x - c.rho * sn_1 - sn_2);
+    auto bpf = c.alpha * hpf + sn_1;
     if (enableSoftClipper)
-        bpf = std::tanh(bpf);
+        bpf = FastTanh::process(softClipperApproximation, bpf);
     
-    auto lpf = alpha * bpf + sn_2;
+    auto lpf = c.alpha * bpf + sn_2;
     auto bsf = hpf + lpf;
-    auto lpf2 = matchAnalogNyquistLPF ? lpf + sigma * sn_1 : lpf;
+    auto lpf2 = matchAnalogNyquistLPF ? lpf + c.sigma * sn_1 : lpf;
         
-    sn_1 = alpha * hpf + bpf;
-    sn_2 = alpha * bpf + lpf;
+    sn_1 = c.alpha * hpf + bpf;
+    sn_2 = c.alpha * bpf + lpf;
         
     return bsfMix * bsf + bpfMix * bpf + hpfMix * hpf + lpfMix * lpf2;
 }
 
+inline StereoRegister StereoVASVFilter::processSample(StereoRegister x)
+{
+    const auto& c = coeffs;
+    
+    if (enableGainComp)
+        x *= c.halfPeak;
+    
+    auto hpf = (x - sn_1 * c.rho - sn_2) * c.alpha_0;
+    auto bpf = hpf * c.alpha + sn_1;
+    if (enableSoftClipper)
+        bpf = FastTanh::process(softClipperApproximation, bpf);
+    
+    auto lpf = bpf * c.alpha + sn_2;
+    auto bsf = hpf + lpf;
+    auto lpf2 = matchAnalogNyquistLPF ? lpf + sn_1 * c.sigma : lpf;
+    
+    sn_1 = hpf * c.alpha + bpf;
+    sn_2 = bpf * c.alpha + lpf;
+    
+    return bsf * bsfMix + bpf * bpfMix + hpf * hpfMix + lpf2 * lpfMix;
+}
+
+void StereoVASVFilter::processBlock(float* left, float* right, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        storeStereo(processSample(loadStereo(left[i], right[i])), left[i], right[i]);
+}
+
+void StereoVASVFilter::processBlock(float* left, float* right, const float* cutoff, const float* resonance, int numSamples, int controlInterval)
+{
+    for (int start = 0; start < numSamples; start += controlInterval)
+    {
+        const int end = jmin(start + controlInterval, numSamples);
+        
+        // the control point is the last sample of the segment, so a finished ramp lands on the exact coefficients
+        fc = cutoff[end - 1];
+        q = resonance[end - 1];
+        
+        VASVFilterCoeffs target;
+        target.calculate(fc, q, fs);
+        const auto increment = coeffs.getIncrement(target, end - start);
+        
+        for (int i = start; i < end - 1; ++i)
+        {
+            coeffs.advance(increment);
+            storeStereo(processSample(loadStereo(left[i], right[i])), left[i], right[i]);
+        }
+        
+        coeffs = target;
+        storeStereo(processSample(loadStereo(left[end - 1], right[end - 1])), left[end - 1], right[end - 1]);
+    }
+}
+
 void VASVFilter::calcCoeffs(bool force)
 {
     if (!force && !fc.isSmoothing() && !q.isSmoothing())
@@ -51,17 +147,13 @@ void VASVFilter::calcCoeffs(bool force)
     if (force || fc.isSmoothing())
     {
         auto currentFc = fc.getNextValue();
-        // alpha = std::tan((MathConstants<float>::pi * currentFc) / fs);
-        alpha = dsp::FastMathApproximations::tan((MathConstants<float>::pi * currentFc) / fs);
-        sigma = (4.0f * currentFc * currentFc) / (alpha * fs * fs);
+        VASVFilterCutoffTable::getInstance().lookup(currentFc / fs, alpha, sigma);
     }
     
     if (force || q.isSmoothing())
     {
         auto currentQ = q.getNextValue();
-        auto peak_dB = Decibels::gainToDecibels(peakGainForQ(currentQ));
-        if (peak_dB > 0.0f)
-            halfPeak = Decibels::decibelsToGain(-peak_dB * 0.5f);
+        halfPeak = halfPeakGainForQ(currentQ);
         
         r = 1.0f / (2.0f * currentQ);
     }
@@ -2,8 +2,62 @@
 
 #include <juce_core/juce_core.h>
 
+#include "FastTanh.h"
 #include "ProcessorUtils.h"
 
+// alpha and sigma only depend on the normalised cutoff fc / fs, so one interpolated table serves every filter
+// at every sample rate. It is built on first use, each filter touches it in reset() to keep that off the audio thread.
+class VASVFilterCutoffTable
+{
+public:
+    static const VASVFilterCutoffTable& getInstance();
+    
+    inline void lookup(float normalisedCutoff, float& alpha, float& sigma) const noexcept
+    {
+        const auto position = jlimit(0.0f, MAX_NORMALISED_CUTOFF, normalisedCutoff) * (TABLE_SIZE / MAX_NORMALISED_CUTOFF);
+        const auto index = jmin((int) position, TABLE_SIZE - 1);
+        const auto fraction = position - (float) index;
+        
+        const auto& e0 = entries[index];
+        const auto& e1 = entries[index + 1];
+        alpha = e0.alpha + fraction * (e1.alpha - e0.alpha);
+        sigma = e0.sigma + fraction * (e1.sigma - e0.sigma);
+    }
+    
+private:
+    VASVFilterCutoffTable();
+    
+    // tan(pi * fc / fs) has a pole at Nyquist, cutoffs above this are clamped
+    static constexpr float MAX_NORMALISED_CUTOFF = 0.49f;
+    static constexpr int TABLE_SIZE = 1024;
+    
+    struct Entry
+    {
+        float alpha;
+        float sigma;
+    };
+    
+    Entry entries[TABLE_SIZE + 1];
+    
+    JUCE_DECLARE_NON_COPYABLE(VASVFilterCutoffTable)
+};
+
+struct VASVFilterCoeffs
+{
+    void calculate(float fc, float q, float fs);
+
+    // per sample increments that take these coefficients to target in numSteps
+    VASVFilterCoeffs getIncrement(const VASVFilterCoeffs& target, int numSteps) const;
+    void advance(const VASVFilterCoeffs& increment);
+
+    float halfPeak = 1.0f;
+    float alpha = 0.0f;
+    float alpha_0 = 0.0f;
+    float r = 0.707f;
+    float rho = 1.414f;
+    float sigma = 0.0f;
+};
+
 class StaticVASVFilter
 {
 public:
@@ -14,6 +68,8 @@ public:
         fs = sampleRate;
         sn_1 = 0.0f;
         sn_2 = 0.0f;
+        VASVFilterCutoffTable::getInstance();
+        FastTanhTable::getInstance();
     }
     
     void setParameters(float _fc, float _q, bool _enableGainComp, bool _enableSoftClipper, float _bsfMix, float _bpfMix, float _hpfMix, float _lpfMix, bool _matchAnalogNyquistLPF)
@@ -30,9 +86,12 @@ public:
         
         matchAnalogNyquistLPF = _matchAnalogNyquistLPF;
         
-        calcCoeffs();
+        coeffs.calculate(fc, q, fs);
     }
     
+    // the tanh used by the band-pass soft clipper, when it is enabled
+    void setSoftClipperApproximation(FastTanh::Approximation approximation) { softClipperApproximation = approximation; }
+    
     float processSample(float x);
     
 private:
@@ -42,13 +101,9 @@ private:
     float q = 0.707f;
     bool enableGainComp = false;
     bool enableSoftClipper = false;
+    FastTanh::Approximation softClipperApproximation = FastTanh::PADE;
     
-    float halfPeak = 1.0f;
-    float alpha = 0.0f;
-    float alpha_0 = 0.0f;
-    float r = 0.707f;
-    float rho = 1.414f;
-    float sigma = 0.0f;
+    VASVFilterCoeffs coeffs;
     
     float sn_1 = 0.0f;
     float sn_2 = 0.0f;
@@ -60,11 +115,77 @@ private:
     
     bool matchAnalogNyquistLPF = true;
     
-    void calcCoeffs();
-    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StaticVASVFilter)
 };
 
+// Same filter as StaticVASVFilter, running the left and right channel in one SIMD register.
+// Both channels always share the same parameters, so the coefficients are only calculated once.
+class StereoVASVFilter
+{
+public:
+    StereoVASVFilter() {}
+    
+    void reset(float sampleRate)
+    {
+        fs = sampleRate;
+        sn_1 = 0.0f;
+        sn_2 = 0.0f;
+        VASVFilterCutoffTable::getInstance();
+        FastTanhTable::getInstance();
+    }
+    
+    void setParameters(float _fc, float _q, bool _enableGainComp, bool _enableSoftClipper, float _bsfMix, float _bpfMix, float _hpfMix, float _lpfMix, bool _matchAnalogNyquistLPF)
+    {
+        fc = _fc;
+        q = _q;
+        enableGainComp = _enableGainComp;
+        enableSoftClipper = _enableSoftClipper;
+        
+        bsfMix = _bsfMix;
+        bpfMix = _bpfMix;
+        hpfMix = _hpfMix;
+        lpfMix = _lpfMix;
+        
+        matchAnalogNyquistLPF = _matchAnalogNyquistLPF;
+        
+        coeffs.calculate(fc, q, fs);
+    }
+    
+    // the tanh used by the band-pass soft clipper, when it is enabled
+    void setSoftClipperApproximation(FastTanh::Approximation approximation) { softClipperApproximation = approximation; }
+    
+    void processBlock(float* left, float* right, int numSamples);
+    
+    // cutoff and q given per sample, while they are smoothing. The coefficients are only calculated every
+    // controlInterval samples and linearly interpolated in between.
+    void processBlock(float* left, float* right, const float* cutoff, const float* resonance, int numSamples, int controlInterval);
+    
+private:
+    float fs = 44100.0f;
+    
+    float fc = 1000.0f;
+    float q = 0.707f;
+    bool enableGainComp = false;
+    bool enableSoftClipper = false;
+    FastTanh::Approximation softClipperApproximation = FastTanh::PADE;
+    
+    VASVFilterCoeffs coeffs;
+    
+    StereoRegister sn_1 { 0.0f };
+    StereoRegister sn_2 { 0.0f };
+    
+    float bsfMix = 0.0f;
+    float bpfMix = 0.0f;
+    float hpfMix = 0.0f;
+    float lpfMix = 0.0f;
+    
+    bool matchAnalogNyquistLPF = true;
+    
+    inline StereoRegister processSample(StereoRegister x);
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoVASVFilter)
+};
+
 class VASVFilter
 {
 public: